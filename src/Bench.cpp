@@ -0,0 +1,250 @@
+//
+// Fixed position suites for comparing search configurations
+//
+
+#include "Bench.hpp"
+
+#include <sstream>
+#include <thread>
+
+const std::vector<std::string> bench_positions = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2bppp/2n1pn2/2pp4/3P4/2PBPN2/PP1N1PPP/R1BQ1RK1 w - - 0 8",
+        "2rq1rk1/pp1bppbp/2np1np1/8/3NP3/1BN1BP2/PPPQ2PP/2KR3R b - - 0 12",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r2q1rk1/ppp2ppp/2n1bn2/2bpp3/4P3/2PP1NP1/PP1N1PBP/R1BQ1RK1 w - - 0 8",
+        "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "3r2k1/p4ppp/1p2p3/8/3P4/P3P3/1P3PPP/2R3K1 w - - 0 25",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "8/8/b2p3p/7k/7P/K5P1/4p3/3B4 b - - 1 71",
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+        "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+        "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+        "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+        "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+        "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+        "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+        "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+        "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+        "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+        "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+        "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+        "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+        "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+        "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+        "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+        "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+        "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+        "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+        "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+        "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+        "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+        "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+        "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+        "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+        "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+        "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+        "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+        "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+        "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+        "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+        "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+        "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+        "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+        "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+        "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+        "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+        "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+        "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+        "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+};
+
+void compare_root_drivers(TT& tt, OpeningBook& opening_book, std::atomic<bool>& should_end_search,
+                          unsigned int depth) {
+    const RootDriver drivers[2] = {aspiration_windows, mtdf};
+    const char* driver_names[2] = {"aspiration", "mtdf"};
+    U64 total_nodes[2] = {0, 0};
+    double total_ms[2] = {0, 0};
+
+    for (unsigned int i = 0; i < bench_positions.size(); i++) {
+        std::ostringstream buffer;
+        buffer << "position " << i + 1;
+        for (int d = 0; d < 2; d++) {
+            // Every driver starts from an empty TT so neither benefits from the other's search
+            tt.clear();
+            should_end_search = false;
+            TimeHandler time_handler(should_end_search);
+            Search search(Board(bench_positions[i]), tt, opening_book, time_handler);
+            search.set_root_driver(drivers[d]);
+            search.set_silent(true);
+
+            auto t1 = std::chrono::high_resolution_clock::now();
+            Move best_move = search.find_best_move(depth);
+            auto t2 = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+
+            total_nodes[d] += search.get_nodes_searched();
+            total_ms[d] += ms_double.count();
+            buffer << ' ' << driver_names[d] << ' ' << search.get_nodes_searched() << ' '
+                   << move_to_str(best_move, true);
+        }
+        buffer << '\n';
+        get_synced_cout().print(buffer.str());
+    }
+
+    std::ostringstream buffer;
+    for (int d = 0; d < 2; d++) {
+        buffer << driver_names[d] << ": " << total_nodes[d] << " nodes, " << total_ms[d] << "ms, "
+               << (U64) (total_nodes[d] / (total_ms[d] / 1000 + 1e-9)) << " nps\n";
+    }
+    get_synced_cout().print(buffer.str());
+}
+
+void thread_scaling_report(TT& tt, OpeningBook& opening_book, std::atomic<bool>& should_end_search,
+                           unsigned int depth, unsigned int max_threads, unsigned int repetitions,
+                           unsigned int hash_mb) {
+    const ParallelMode modes[3] = {lazy_smp, abdada, ybwc};
+    const char* mode_names[3] = {"lazysmp", "abdada", "ybwc"};
+
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    // Every run gets the same TT size and a pool with one worker per thread; the caller's sizes are restored at the end
+    unsigned int tt_size_mb = tt.get_size_mb();
+    unsigned int pool_size = get_thread_pool().size();
+    tt.resize(hash_mb);
+
+    get_synced_cout().print("mode,threads,runs,time_ms,time_ms_sd,speedup,nodes,nodes_sd,node_overhead,nps,nps_sd,"
+                            "nps_scaling,tt_hit_rate\n");
+
+    for (int m = 0; m < 3; m++) {
+        double base_ms = 0, base_nodes = 0, base_nps = 0;
+        for (auto threads = thread_counts.begin(); threads != thread_counts.end(); ++threads) {
+            get_thread_pool().resize(*threads);
+
+            // Parallel search isn't deterministic, so each configuration is run several times
+            std::vector<double> run_ms, run_nodes, run_nps;
+            double hit_rate_sum = 0;
+            for (unsigned int run = 0; run < repetitions; run++) {
+                double total_ms = 0;
+                U64 total_nodes = 0;
+                for (unsigned int i = 0; i < bench_positions.size(); i++) {
+                    tt.clear();
+                    should_end_search = false;
+                    TimeHandler time_handler(should_end_search);
+                    Search search(Board(bench_positions[i]), tt, opening_book, time_handler);
+                    search.set_threads(*threads);
+                    search.set_parallel_mode(modes[m]);
+                    search.set_silent(true);
+
+                    auto t1 = std::chrono::high_resolution_clock::now();
+                    search.find_best_move(depth);
+                    auto t2 = std::chrono::high_resolution_clock::now();
+                    std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+
+                    total_nodes += search.get_total_nodes();
+                    total_ms += ms_double.count();
+                    hit_rate_sum += search.get_tt_hit_rate();
+                }
+                run_ms.push_back(total_ms);
+                run_nodes.push_back(total_nodes);
+                run_nps.push_back(total_nodes / (total_ms / 1000 + 1e-9));
+            }
+
+            double ms, ms_sd, nodes, nodes_sd, nps, nps_sd;
+            mean_and_stddev(run_ms, ms, ms_sd);
+            mean_and_stddev(run_nodes, nodes, nodes_sd);
+            mean_and_stddev(run_nps, nps, nps_sd);
+            if (*threads == 1) {
+                base_ms = ms;
+                base_nodes = nodes;
+                base_nps = nps;
+            }
+
+            std::ostringstream buffer;
+            buffer << mode_names[m] << ',' << *threads << ',' << repetitions << ',' << ms << ',' << ms_sd << ','
+                   << base_ms / ms << ',' << (U64) nodes << ',' << nodes_sd << ',' << nodes / base_nodes << ','
+                   << (U64) nps << ',' << nps_sd << ',' << nps / base_nps << ','
+                   << hit_rate_sum / (repetitions * bench_positions.size()) << '\n';
+            get_synced_cout().print(buffer.str());
+        }
+    }
+
+    tt.resize(tt_size_mb);
+    get_thread_pool().resize(pool_size);
+}
+
+U64 run_bench(TT& tt, OpeningBook& opening_book, std::atomic<bool>& should_end_search, unsigned int depth,
+              unsigned int threads, unsigned int hash_mb) {
+    // The bench gets its own TT size and pool size, the caller's are restored at the end
+    unsigned int tt_size_mb = tt.get_size_mb();
+    unsigned int pool_size = get_thread_pool().size();
+    tt.resize(hash_mb);
+    get_thread_pool().resize(threads);
+
+    U64 total_nodes = 0;
+    double total_ms = 0;
+
+    for (unsigned int i = 0; i < bench_positions.size(); i++) {
+        // Fixed depth searches never use the book, and every position starts from an empty TT so that the node
+        // count doesn't depend on the positions searched before it
+        tt.clear();
+        should_end_search = false;
+        TimeHandler time_handler(should_end_search);
+        Search search(Board(bench_positions[i]), tt, opening_book, time_handler);
+        search.set_threads(threads);
+        search.set_silent(true);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        Move best_move = search.find_best_move(depth);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+
+        total_nodes += search.get_total_nodes();
+        total_ms += ms_double.count();
+
+        std::ostringstream buffer;
+        buffer << "position " << i + 1 << '/' << bench_positions.size() << " nodes " << search.get_total_nodes()
+               << " bestmove " << move_to_str(best_move, true) << '\n';
+        get_synced_cout().print(buffer.str());
+    }
+
+    tt.resize(tt_size_mb);
+    get_thread_pool().resize(pool_size);
+
+    std::ostringstream buffer;
+    buffer << "\nTotal time (ms) : " << (U64) total_ms << '\n';
+    buffer << "Nodes searched  : " << total_nodes << '\n';
+    buffer << "Nodes/second    : " << (U64) (total_nodes / (total_ms / 1000 + 1e-9)) << '\n';
+    get_synced_cout().print(buffer.str());
+
+    return total_nodes;
+}
+
+void bench_command(const std::vector<std::string>& cmd, TT& tt, OpeningBook& opening_book,
+                   std::atomic<bool>& should_end_search) {
+    unsigned int depth = cmd.size() > 1 ? std::max(1, std::min(std::stoi(cmd.at(1)), MAX_DEPTH)) : BENCH_DEFAULT_DEPTH;
+    unsigned int threads = cmd.size() > 2 ? std::max(1, std::min(std::stoi(cmd.at(2)), MAX_THREADS))
+                                          : BENCH_DEFAULT_THREADS;
+    unsigned int hash_mb = cmd.size() > 3 ? std::max(1, std::min(std::stoi(cmd.at(3)), TT_MAX_MB))
+                                          : BENCH_DEFAULT_HASH_MB;
+    run_bench(tt, opening_book, should_end_search, depth, threads, hash_mb);
+}
+
+void scaling_command(const std::vector<std::string>& cmd, TT& tt, OpeningBook& opening_book,
+                     std::atomic<bool>& should_end_search) {
+    unsigned int depth = cmd.size() > 1 ? std::max(1, std::min(std::stoi(cmd.at(1)), MAX_DEPTH)) : BENCH_DEFAULT_DEPTH;
+    unsigned int max_threads = cmd.size() > 2 ? std::max(1, std::min(std::stoi(cmd.at(2)), MAX_THREADS))
+                                              : std::max(1U, std::thread::hardware_concurrency());
+    unsigned int repetitions = cmd.size() > 3 ? std::max(1, std::stoi(cmd.at(3))) : SCALING_DEFAULT_REPETITIONS;
+    unsigned int hash_mb = cmd.size() > 4 ? std::max(1, std::min(std::stoi(cmd.at(4)), TT_MAX_MB))
+                                          : BENCH_DEFAULT_HASH_MB;
+    thread_scaling_report(tt, opening_book, should_end_search, depth, max_threads, repetitions, hash_mb);
+}
@@ -0,0 +1,46 @@
+//
+// Fixed position suites for comparing search configurations
+//
+
+#ifndef BITBOARD_CHESS_BENCH_HPP
+#define BITBOARD_CHESS_BENCH_HPP
+
+#include "depend.hpp"
+#include "Board.hpp"
+#include "Search.hpp"
+#include "Transposition_table.hpp"
+#include "Opening_book.hpp"
+#include "Time_handler.hpp"
+
+#define BENCH_DEFAULT_DEPTH 12
+#define BENCH_DEFAULT_THREADS 1
+#define BENCH_DEFAULT_HASH_MB 16
+#define SCALING_DEFAULT_REPETITIONS 3
+
+extern const std::vector<std::string> bench_positions;
+
+// Searches every bench position to a fixed depth and prints the total node count and nps
+// With one thread the node count is a signature of the search: any change to it means the search behaves differently
+U64 run_bench(TT& tt, OpeningBook& opening_book, std::atomic<bool>& should_end_search, unsigned int depth,
+              unsigned int threads, unsigned int hash_mb);
+
+// bench [depth] [threads] [hash], from the UCI loop or the command line
+void bench_command(const std::vector<std::string>& cmd, TT& tt, OpeningBook& opening_book,
+                   std::atomic<bool>& should_end_search);
+
+// Searches every bench position to a fixed depth with each root driver and prints the node counts
+void compare_root_drivers(TT& tt, OpeningBook& opening_book, std::atomic<bool>& should_end_search,
+                          unsigned int depth);
+
+// Time to depth, node overhead, nps and TT hit rate of every parallel mode at 1, 2, 4, ... max_threads threads
+// Each configuration is searched repetitions times with a hash_mb TT; prints one CSV row per configuration with the
+// mean and standard deviation over the runs, and the ratios to one thread
+void thread_scaling_report(TT& tt, OpeningBook& opening_book, std::atomic<bool>& should_end_search,
+                           unsigned int depth, unsigned int max_threads, unsigned int repetitions,
+                           unsigned int hash_mb);
+
+// scaling [depth] [max threads] [repetitions] [hash], from the UCI loop or the command line
+void scaling_command(const std::vector<std::string>& cmd, TT& tt, OpeningBook& opening_book,
+                     std::atomic<bool>& should_end_search);
+
+#endif //BITBOARD_CHESS_BENCH_HPP
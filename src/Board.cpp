@@ -203,6 +203,71 @@ void Board::read_FEN(std::string str) {
     }
 }
 
+std::string Board::get_FEN() {
+    // Inverse of read_FEN
+    const char piece_chars[] = "kqrbnp";
+    std::string fen;
+
+    for (int y = 0; y < 8; y++) {
+        int blanks = 0;
+        for (int x = 0; x < 8; x++) {
+            U64 square = C64(1) << cords_to_index(x, y);
+            char c = 0;
+            for (int i = Kings; i <= Pawns; i++) {
+                if (Bitboards[i] & square) {
+                    c = piece_chars[i - Kings];
+                    if (Bitboards[WhitePieces] & square) {
+                        c = (char) toupper(c);
+                    }
+                }
+            }
+            if (c) {
+                if (blanks) {
+                    fen += (char) ('0' + blanks);
+                    blanks = 0;
+                }
+                fen += c;
+            } else {
+                blanks++;
+            }
+        }
+        if (blanks) {
+            fen += (char) ('0' + blanks);
+        }
+        if (y < 7) {
+            fen += '/';
+        }
+    }
+
+    fen += current_turn == WHITE ? " w " : " b ";
+
+    std::string castling;
+    if (white_can_castle_kingside) {
+        castling += 'K';
+    }
+    if (white_can_castle_queenside) {
+        castling += 'Q';
+    }
+    if (black_can_castle_kingside) {
+        castling += 'k';
+    }
+    if (black_can_castle_queenside) {
+        castling += 'q';
+    }
+    fen += castling.empty() ? "-" : castling;
+
+    if (en_passant_square == -1) {
+        fen += " -";
+    } else {
+        fen += ' ';
+        fen += (char) ('a' + en_passant_square % 8);
+        fen += (char) ('1' + en_passant_square / 8);
+    }
+
+    fen += ' ' + std::to_string(halfmove_counter) + ' ' + std::to_string(fullmove_counter);
+    return fen;
+}
+
 Move Board::read_SAN(std::string str) {
     // Reads Standard Algebraic Notation
     // Checks for legality of move
@@ -2033,7 +2098,8 @@ int Board::static_exchange_eval(Move move) {
     do {
         d++; // next depth and side
         gain[d] = piece_to_value[attacking_piece] - gain[d - 1]; // speculative store, if defended
-        if (std::max(-gain[d - 1], gain[d]) < 0) break; // pruning does not influence the result
+        // Capturing can't beat standing pat even if nothing recaptures, so the result doesn't depend on the rest
+        if (gain[d] <= -gain[d - 1]) break;
         att_def ^= from_set; // reset bit in set to traverse
         occ ^= from_set; // reset bit in temporary occupancy (for x-Rays)
         if (from_set & may_xray) {
@@ -2083,6 +2149,14 @@ int* Board::get_piece_values() {
     return piece_values;
 }
 
+int* Board::get_piece_square_values_m() {
+    return piece_square_values_m;
+}
+
+int* Board::get_piece_square_values_e() {
+    return piece_square_values_e;
+}
+
 void Board::print_piece_values() {
     std::cout << "\nWhite Piece Values: " << piece_values[WhitePieces];
     std::cout << "\nBlack Piece Values: " << piece_values[BlackPieces] << '\n';
@@ -2317,6 +2391,10 @@ U64 Board::get_z_key() {
     return z_key;
 }
 
+U64 Board::get_occupancy() {
+    return Bitboards[WhitePieces] | Bitboards[BlackPieces];
+}
+
 std::vector<move_data> Board::get_move_stack() {
     return move_stack;
 }
@@ -63,6 +63,8 @@ public:
 
     void read_FEN(std::string str);
 
+    std::string get_FEN();
+
     Move read_SAN(std::string str);
 
     Move read_LAN(std::string str);
@@ -168,6 +170,10 @@ public:
 
     int* get_piece_values();
 
+    int* get_piece_square_values_m();
+
+    int* get_piece_square_values_e();
+
     void print_piece_values();
 
     void calculate_piece_square_values();
@@ -197,6 +203,8 @@ public:
     // Produce info
     U64 get_z_key();
 
+    U64 get_occupancy();
+
     std::vector<move_data> get_move_stack();
 
     bool get_reg_starting_pos();
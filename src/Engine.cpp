@@ -16,7 +16,15 @@ void Engine::loop() {
     Board board;
     TT tt;
     OpeningBook opening_book;
-    TimeHandler inf_time(should_end_search);
+    MateTable mate_table;
+    PerftTable perft_table;
+    MctsArena mcts_arena;
+    unsigned int multi_pv = 1;
+    RootDriver root_driver = aspiration_windows;
+    SearchMode search_mode = alpha_beta_mode;
+    unsigned int threads = 1;
+    ParallelMode parallel_mode = lazy_smp;
+    bool debug = false;
 
     while (true) {
         std::vector<std::string> cmd = cmd_queue.dequeue();
@@ -26,42 +34,11 @@ void Engine::loop() {
                 return;
             } else if (cmd.at(0) == "go") {
                 if (cmd.at(1) == "perft") {
-                    int perft_depth = std::stoi(cmd.at(2));
+                    unsigned int perft_depth = std::max(1, std::stoi(cmd.at(2)));
+                    perft_divide(board, perft_depth, perft_table);
 
-                    MoveList moves;
-                    board.generate_moves(moves);
-
-                    long perft_sum = 0;
-
-                    auto t1 = std::chrono::high_resolution_clock::now();
-
-                    for (int i = 0; i < moves.size(); i++) {
-
-                        board.make_move(moves[i]);
-
-                        Search search(board, tt, opening_book, inf_time);
-                        long perft_score = search.perft(perft_depth - 1);
-                        perft_sum += perft_score;
-                        std::ostringstream buffer;
-                        buffer << move_to_str(moves[i], true) << ": ";
-                        buffer << perft_score << '\n';
-                        get_synced_cout().print(buffer.str());
-
-                        board.unmake_move();
-
-                    }
-                    auto t2 = std::chrono::high_resolution_clock::now();
-                    std::chrono::duration<double, std::milli> ms_double = t2 - t1;
-                    std::ostringstream buffer;
-                    buffer << "\nNodes Searched: " << perft_sum << '\n';
-                    buffer << "Time: " << ms_double.count() << "ms\n\n";
-                    get_synced_cout().print(buffer.str());
-
-                } else if (cmd.at(1) == "infinite") {
-                    Search search(board, tt, opening_book, inf_time);
-                    search.find_best_move(64);
                 } else {
-                    int max_depth = 64;
+                    int max_depth = MAX_DEPTH;
                     double time_ms = 0;
                     TimerType t_type = constant_time;
                     int wtime = 0;
@@ -69,21 +46,42 @@ void Engine::loop() {
                     int winc  = 0;
                     int binc  = 0;
                     int moves_to_go = -1;
+                    U64 node_limit = 0;
+                    unsigned int mate_limit = 0;
+                    bool infinite = false;
+                    std::vector<Move> search_moves;
 
-                    for (int i = 1; i < cmd.size(); i += 2) {
+                    for (size_t i = 1; i < cmd.size(); i++) {
                         if (cmd.at(i) == "movetime") {
-                            time_ms = std::stoi(cmd.at(i + 1));
+                            time_ms = std::stoi(cmd.at(++i));
                             time_ms -= 100;
                         } else if (cmd.at(i) == "wtime") {
-                            wtime = std::stoi(cmd.at(i + 1));
+                            wtime = std::stoi(cmd.at(++i));
                         } else if (cmd.at(i) == "btime") {
-                            btime = std::stoi(cmd.at(i + 1));
+                            btime = std::stoi(cmd.at(++i));
                         } else if (cmd.at(i) == "movestogo") {
-                            moves_to_go = std::stoi(cmd.at(i + 1));
+                            moves_to_go = std::stoi(cmd.at(++i));
                         } else if (cmd.at(i) == "winc") {
-                            winc = std::stoi(cmd.at(i + 1));
+                            winc = std::stoi(cmd.at(++i));
                         } else if (cmd.at(i) == "binc") {
-                            binc = std::stoi(cmd.at(i + 1));
+                            binc = std::stoi(cmd.at(++i));
+                        } else if (cmd.at(i) == "depth") {
+                            max_depth = std::max(1, std::min(std::stoi(cmd.at(++i)), MAX_DEPTH));
+                        } else if (cmd.at(i) == "nodes") {
+                            node_limit = std::stoull(cmd.at(++i));
+                        } else if (cmd.at(i) == "mate") {
+                            int mate_moves = std::stoi(cmd.at(++i));
+                            if (mate_moves < 0) {
+                                throw std::invalid_argument("go mate");
+                            }
+                            mate_limit = mate_moves;
+                        } else if (cmd.at(i) == "infinite") {
+                            infinite = true;
+                        } else if (cmd.at(i) == "searchmoves") {
+                            // searchmoves takes every following token that looks like a move
+                            while (i + 1 < cmd.size() && cmd.at(i + 1).size() >= 4 && isdigit(cmd.at(i + 1)[1])) {
+                                search_moves.push_back(board.read_LAN(cmd.at(++i)));
+                            }
                         }
                     }
 
@@ -102,17 +100,55 @@ void Engine::loop() {
                     }
                     time_ms += current_inc * 0.5;
 
+                    // Without a clock the search only ends on its own limits or on stop
+                    if (infinite || time_ms == 0) {
+                        t_type = inf;
+                    }
+
+                    // go mate is answered by the proof-number search, falling back to alpha-beta if it disproves
+                    // the mate so that a bestmove is still given
+                    // Both share one deadline: the fallback only gets the time the proof-number search left
+                    if (mate_limit) {
+                        auto mate_start = std::chrono::steady_clock::now();
+                        TimeHandler mate_time_handler(should_end_search, t_type, time_ms);
+                        MateSearch mate_search(board, mate_table, mate_time_handler);
+                        if (mate_search.find_mate(mate_limit)) {
+                            continue;
+                        }
+                        std::chrono::duration<double, std::milli> mate_ms =
+                                std::chrono::steady_clock::now() - mate_start;
+                        time_ms = std::max(1.0, time_ms - mate_ms.count());
+                        max_depth = std::min(max_depth, (int) (2 * mate_limit));
+                    }
+
                     TimeHandler time_handler(should_end_search, t_type, time_ms);
+
+                    if (search_mode == mcts_mode && !mate_limit) {
+                        MctsSearch mcts_search(board, tt, opening_book, time_handler, mcts_arena);
+                        mcts_search.set_threads(threads);
+                        mcts_search.set_node_limit(node_limit);
+                        mcts_search.find_best_move();
+                        continue;
+                    }
+
                     Search search(board, tt, opening_book, time_handler);
+                    search.set_multi_pv(multi_pv);
+                    search.set_debug(debug);
+                    search.set_root_driver(root_driver);
+                    search.set_threads(threads);
+                    search.set_parallel_mode(parallel_mode);
+                    search.set_node_limit(node_limit);
+                    search.set_mate_limit(mate_limit);
+                    search.set_search_moves(search_moves);
                     search.find_best_move(max_depth);
                 }
             } else if (cmd.at(0) == "position") {
-                int j = 1;
+                size_t j = 1;
                 while (j < cmd.size()) {
                     if (cmd.at(j) == "fen") {
                         std::string fen;
-                        int j_save = j;
-                        for (int i = j + 1; i < j_save + 7; i++) {
+                        size_t j_save = j;
+                        for (size_t i = j + 1; i < j_save + 7; i++) {
                             fen += cmd.at(i) + ' ';
                         }
                         fen.pop_back();
@@ -120,23 +156,68 @@ void Engine::loop() {
                     } else if (cmd.at(j) == "startpos") {
                         board = Board();
                     } else if (cmd.at(j) == "moves") {
-                        for (int i = j + 1; i < cmd.size(); i++) {
+                        for (size_t i = j + 1; i < cmd.size(); i++) {
                             Move move = board.read_LAN(cmd.at(i));
                             board.make_move(move);
                         }
                     }
                     j++;
                 }
+            } else if (cmd.at(0) == "setoption") {
+                // setoption name <id> [value <x>]
+                std::string name, value;
+                std::string* field = nullptr;
+                for (size_t i = 1; i < cmd.size(); i++) {
+                    if (cmd.at(i) == "name") {
+                        field = &name;
+                    } else if (cmd.at(i) == "value") {
+                        field = &value;
+                    } else if (field) {
+                        *field += field->empty() ? cmd.at(i) : ' ' + cmd.at(i);
+                    }
+                }
+                if (name == "MultiPV") {
+                    multi_pv = std::max(1, std::min(std::stoi(value), MAX_MULTI_PV));
+                } else if (name == "Hash") {
+                    tt.resize(std::max(1, std::stoi(value)));
+                } else if (name == "MateHash") {
+                    mate_table.resize(std::max(1, std::stoi(value)));
+                } else if (name == "PerftHash") {
+                    perft_table.resize(std::max(0, std::stoi(value)));
+                } else if (name == "Threads") {
+                    threads = std::max(1, std::min(std::stoi(value), MAX_THREADS));
+                    get_thread_pool().resize(threads);
+                } else if (name == "ParallelMode") {
+                    parallel_mode = value == "ABDADA" ? abdada : value == "YBWC" ? ybwc : lazy_smp;
+                } else if (name == "SearchMode") {
+                    search_mode = value == "MCTS" ? mcts_mode : alpha_beta_mode;
+                } else if (name == "RootDriver") {
+                    root_driver = value == "MTDF" ? mtdf : aspiration_windows;
+                }
+            } else if (cmd.at(0) == "debug") {
+                debug = cmd.at(1) == "on";
+            } else if (cmd.at(0) == "bench") {
+                bench_command(cmd, tt, opening_book, should_end_search);
+            } else if (cmd.at(0) == "comparedrivers") {
+                // comparedrivers [depth]
+                unsigned int depth = cmd.size() > 1 ? std::max(1, std::min(std::stoi(cmd.at(1)), MAX_DEPTH)) : 8;
+                compare_root_drivers(tt, opening_book, should_end_search, depth);
+            } else if (cmd.at(0) == "scaling") {
+                scaling_command(cmd, tt, opening_book, should_end_search);
+            } else if (cmd.at(0) == "epd") {
+                epd_command(cmd);
             } else if (cmd.at(0) == "printboard") {
                 board.print_board();
             } else if (cmd.at(0) == "ucinewgame") {
                 board = Board();
                 tt.clear();
+                mate_table.clear();
                 opening_book.reset();
             }
         }
-        catch (std::out_of_range& e) {
-            std::cerr << "Insufficient parameters\n";
+        catch (std::logic_error& e) {
+            // Missing parameters throw std::out_of_range and non-numeric values std::invalid_argument
+            std::cerr << "Insufficient or invalid parameters\n";
         }
     }
 }
@@ -15,8 +15,19 @@
 #include "Transposition_table.hpp"
 #include "Opening_book.hpp"
 #include "Thread.hpp"
+#include "Bench.hpp"
+#include "Mate_search.hpp"
+#include "Mcts_search.hpp"
+#include "Perft.hpp"
+#include "Epd.hpp"
 
 
+// Search algorithm used by go, picked with the SearchMode option
+enum SearchMode {
+    alpha_beta_mode,
+    mcts_mode,
+};
+
 class Engine {
 private:
     Thread::SafeQueue<std::vector<std::string>>& cmd_queue;
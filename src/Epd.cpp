@@ -0,0 +1,247 @@
+//
+// Test suites of EPD positions with bm/am operations, searched concurrently on the thread pool
+//
+
+#include "Epd.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+bool parse_epd_line(const std::string& line, EpdPosition& position) {
+    std::istringstream stream(line);
+    std::string fields[4];
+    for (int i = 0; i < 4; i++) {
+        if (!(stream >> fields[i])) {
+            return false;
+        }
+    }
+
+    // Some files keep the move counters of a full FEN before the operations
+    std::string counters[2] = {"0", "1"};
+    for (int i = 0; i < 2; i++) {
+        std::streampos before = stream.tellg();
+        std::string token;
+        if (!(stream >> token) || !std::all_of(token.begin(), token.end(), ::isdigit)) {
+            stream.clear();
+            stream.seekg(before);
+            break;
+        }
+        counters[i] = token;
+    }
+
+    position.fen = fields[0] + ' ' + fields[1] + ' ' + fields[2] + ' ' + fields[3] + ' ' + counters[0] + ' ' +
+                   counters[1];
+    position.id.clear();
+    position.best_moves.clear();
+    position.avoid_moves.clear();
+
+    Board board(position.fen);
+    MoveList legal_moves;
+    board.generate_moves(legal_moves);
+
+    std::string operation;
+    while (std::getline(stream, operation, ';')) {
+        std::istringstream op_stream(operation);
+        std::string opcode;
+        if (!(op_stream >> opcode)) {
+            continue;
+        }
+
+        if (opcode == "bm" || opcode == "am") {
+            std::string san;
+            while (op_stream >> san) {
+                // Drop annotations like "Rxb2!" that read_SAN doesn't expect
+                while (!san.empty() && (san.back() == '!' || san.back() == '?')) {
+                    san.pop_back();
+                }
+                if (san.empty()) {
+                    continue;
+                }
+                Move move = board.read_SAN(san);
+                if (!legal_moves.contains(move)) {
+                    return false;
+                }
+                (opcode == "bm" ? position.best_moves : position.avoid_moves).push_back(move);
+            }
+        } else if (opcode == "id") {
+            std::string id;
+            std::getline(op_stream, id);
+            id.erase(std::remove(id.begin(), id.end(), '"'), id.end());
+            while (!id.empty() && id.front() == ' ') {
+                id.erase(id.begin());
+            }
+            position.id = id;
+        }
+    }
+
+    return !position.best_moves.empty() || !position.avoid_moves.empty();
+}
+
+std::vector<EpdPosition> read_epd_file(const std::string& path) {
+    std::vector<EpdPosition> positions;
+    std::ifstream file(path);
+    if (!file) {
+        get_synced_cout().print("info string could not open " + path + '\n');
+        return positions;
+    }
+
+    std::string line;
+    unsigned int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (split(line).empty()) {
+            continue;
+        }
+        EpdPosition position;
+        if (parse_epd_line(line, position)) {
+            if (position.id.empty()) {
+                position.id = std::to_string(line_number);
+            }
+            positions.push_back(position);
+        } else {
+            get_synced_cout().print("info string skipped line " + std::to_string(line_number) +
+                                    ", no usable bm or am\n");
+        }
+    }
+    return positions;
+}
+
+bool is_epd_solution(const EpdPosition& position, Move move) {
+    bool is_best = position.best_moves.empty();
+    for (Move best_move : position.best_moves) {
+        is_best |= best_move == move;
+    }
+    for (Move avoid_move : position.avoid_moves) {
+        if (avoid_move == move) {
+            return false;
+        }
+    }
+    return is_best;
+}
+
+void run_epd_suite(const std::vector<EpdPosition>& positions, unsigned int movetime_ms,
+                   unsigned int concurrent_positions, unsigned int hash_mb) {
+    // The caller's pool size is restored at the end
+    unsigned int pool_size = get_thread_pool().size();
+    get_thread_pool().resize(concurrent_positions);
+
+    // Suites test the search, so the book is never consulted
+    OpeningBook opening_book;
+    opening_book.set_use_book(false);
+
+    std::vector<EpdResult> results(positions.size());
+    std::atomic<unsigned int> next_position(0);
+    unsigned int finished = 0;
+    std::mutex finished_lock;
+
+    // One task per search in flight, each taking the next position until none are left
+    // The waiting thread may run one of them, so the number of tasks rather than the pool size bounds the searches
+    auto search_positions = [&]() {
+        TT tt(hash_mb);
+        for (unsigned int i = next_position++; i < positions.size(); i = next_position++) {
+            const EpdPosition& position = positions[i];
+            EpdResult& result = results[i];
+            result.solved = false;
+
+            tt.clear();
+            std::atomic<bool> should_end_search(false);
+            TimeHandler time_handler(should_end_search, constant_time, movetime_ms);
+            Search search(Board(position.fen), tt, opening_book, time_handler);
+            search.set_silent(true);
+
+            auto t1 = std::chrono::high_resolution_clock::now();
+            search.set_iteration_callback([&](unsigned int depth, Move best_move, int) {
+                if (!is_epd_solution(position, best_move)) {
+                    result.solved = false;
+                } else if (!result.solved) {
+                    std::chrono::duration<double, std::milli> ms_double =
+                            std::chrono::high_resolution_clock::now() - t1;
+                    result.solved = true;
+                    result.solve_ms = ms_double.count();
+                    result.solve_nodes = search.get_total_nodes();
+                    result.solve_depth = depth;
+                }
+            });
+
+            result.best_move = search.find_best_move(MAX_DEPTH);
+            result.nodes = search.get_total_nodes();
+
+            // The move played can still differ from the last completed iteration after a timeout
+            if (!is_epd_solution(position, result.best_move)) {
+                result.solved = false;
+            } else if (!result.solved) {
+                std::chrono::duration<double, std::milli> ms_double = std::chrono::high_resolution_clock::now() - t1;
+                result.solved = true;
+                result.solve_ms = ms_double.count();
+                result.solve_nodes = result.nodes;
+                result.solve_depth = 0;
+            }
+
+            std::lock_guard<std::mutex> lock(finished_lock);
+            finished++;
+            std::ostringstream buffer;
+            buffer << "position " << finished << '/' << positions.size() << ' ' << position.id << " bestmove "
+                   << move_to_str(result.best_move, true);
+            if (result.solved) {
+                buffer << " solved time " << (U64) result.solve_ms << " nodes " << result.solve_nodes << " depth "
+                       << result.solve_depth;
+            } else {
+                buffer << " unsolved";
+            }
+            buffer << '\n';
+            get_synced_cout().print(buffer.str());
+        }
+    };
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    Thread::TaskGroup tasks;
+    for (unsigned int i = 0; i < std::min(concurrent_positions, (unsigned int) positions.size()); i++) {
+        tasks.run(get_thread_pool(), search_positions);
+    }
+    tasks.wait();
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+
+    get_thread_pool().resize(pool_size);
+
+    unsigned int solved = 0;
+    double solve_ms = 0, score = 0;
+    U64 solve_nodes = 0, total_nodes = 0;
+    for (auto it = results.begin(); it != results.end(); ++it) {
+        total_nodes += it->nodes;
+        if (it->solved) {
+            solved++;
+            solve_ms += it->solve_ms;
+            solve_nodes += it->solve_nodes;
+            score += 1 - std::min(it->solve_ms / (2.0 * movetime_ms), 0.5);
+        }
+    }
+
+    std::ostringstream buffer;
+    buffer.setf(std::ios::fixed);
+    buffer.precision(1);
+    buffer << "\nSolved          : " << solved << '/' << positions.size() << '\n';
+    buffer << "Score           : " << 100 * score / positions.size() << "%\n";
+    buffer << "Mean solve time : " << (solved ? solve_ms / solved : 0) << "ms\n";
+    buffer << "Mean solve nodes: " << (solved ? solve_nodes / solved : 0) << '\n';
+    buffer << "Total time (ms) : " << (U64) ms_double.count() << '\n';
+    buffer << "Nodes searched  : " << total_nodes << '\n';
+    buffer << "Nodes/second    : " << (U64) (total_nodes / (ms_double.count() / 1000 + 1e-9)) << '\n';
+    get_synced_cout().print(buffer.str());
+}
+
+void epd_command(const std::vector<std::string>& cmd) {
+    if (cmd.size() < 2) {
+        get_synced_cout().print("info string usage: epd <file> [movetime ms] [concurrent positions] [hash]\n");
+        return;
+    }
+    unsigned int movetime_ms = cmd.size() > 2 ? std::max(1, std::stoi(cmd.at(2))) : EPD_DEFAULT_MOVETIME_MS;
+    unsigned int concurrent_positions = cmd.size() > 3 ? std::max(1, std::min(std::stoi(cmd.at(3)), MAX_THREADS))
+                                                       : std::max(1U, std::thread::hardware_concurrency());
+    unsigned int hash_mb = cmd.size() > 4 ? std::max(1, std::min(std::stoi(cmd.at(4)), TT_MAX_MB))
+                                          : EPD_DEFAULT_HASH_MB;
+    std::vector<EpdPosition> positions = read_epd_file(cmd.at(1));
+    if (!positions.empty()) {
+        run_epd_suite(positions, movetime_ms, concurrent_positions, hash_mb);
+    }
+}
@@ -0,0 +1,58 @@
+//
+// Test suites of EPD positions with bm/am operations, searched concurrently on the thread pool
+//
+
+#ifndef BITBOARD_CHESS_EPD_HPP
+#define BITBOARD_CHESS_EPD_HPP
+
+#include "depend.hpp"
+#include "Board.hpp"
+#include "Search.hpp"
+#include "Transposition_table.hpp"
+#include "Opening_book.hpp"
+#include "Time_handler.hpp"
+#include "Thread.hpp"
+
+#define EPD_DEFAULT_MOVETIME_MS 1000
+#define EPD_DEFAULT_HASH_MB 16 // Every search in flight gets its own TT of this size
+
+
+struct EpdPosition {
+    std::string fen;
+    std::string id;
+    std::vector<Move> best_moves; // bm: the search has to end on one of these
+    std::vector<Move> avoid_moves; // am: the search must not end on any of these
+};
+
+struct EpdResult {
+    Move best_move;
+    bool solved;
+
+    // When the search settled on a correct move for good: from this iteration on the best move never went wrong
+    double solve_ms;
+    U64 solve_nodes;
+    unsigned int solve_depth;
+
+    U64 nodes;
+};
+
+// "<board> <side> <castling> <en passant> [halfmove fullmove] bm Qxf7+; id "name"; ..."
+// False if the line has no bm or am, or one of their moves isn't legal in the position
+bool parse_epd_line(const std::string& line, EpdPosition& position);
+
+// Positions of every usable line, with a note for each line skipped
+std::vector<EpdPosition> read_epd_file(const std::string& path);
+
+bool is_epd_solution(const EpdPosition& position, Move move);
+
+// Searches every position for movetime_ms, concurrent_positions at a time with one single threaded search per
+// worker, printing each result as it finishes and a summary at the end
+// A solved position scores 1 - solve time / (2 * movetime), so of two runs solving the same positions the faster
+// one scores higher; the score is reported as a percentage of the positions
+void run_epd_suite(const std::vector<EpdPosition>& positions, unsigned int movetime_ms,
+                   unsigned int concurrent_positions, unsigned int hash_mb);
+
+// epd <file> [movetime ms] [concurrent positions] [hash per position], from the UCI loop or the command line
+void epd_command(const std::vector<std::string>& cmd);
+
+#endif //BITBOARD_CHESS_EPD_HPP
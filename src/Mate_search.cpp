@@ -0,0 +1,268 @@
+//
+// Depth-bounded df-pn (depth-first proof-number) search for proving forced mates
+//
+
+#include "Mate_search.hpp"
+
+static inline unsigned int saturating_add(unsigned int a, unsigned int b) {
+    return (unsigned int) std::min((U64) a + b, (U64) PN_INFINITY);
+}
+
+MateTable::MateTable(unsigned int size_mb) {
+    resize(size_mb);
+}
+
+void MateTable::resize(unsigned int size_mb) {
+    // Largest power of two number of buckets that fits in size_mb
+    size_mb = std::max(1U, std::min(size_mb, (unsigned int) MATE_HASH_MAX_MB));
+    U64 num_buckets = 1;
+    while (num_buckets * 2 * sizeof(MateBucket) <= (U64) size_mb << 20) {
+        num_buckets *= 2;
+    }
+    buckets.assign(num_buckets, MateBucket());
+    lookup_mask = num_buckets - 1;
+}
+
+bool MateTable::get(U64 key, unsigned int remaining, unsigned int& pn, unsigned int& dn) const {
+    const MateBucket& b = buckets[key & lookup_mask];
+    for (int i = 0; i < MATE_BUCKET_SIZE; i++) {
+        if (b.entries[i].key == key && b.entries[i].remaining == remaining) {
+            pn = b.entries[i].pn;
+            dn = b.entries[i].dn;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MateTable::set(U64 key, unsigned int remaining, unsigned int pn, unsigned int dn, unsigned int work) {
+    MateBucket& b = buckets[key & lookup_mask];
+    MateEntry* replace = &b.entries[0];
+    for (int i = 0; i < MATE_BUCKET_SIZE; i++) {
+        if (b.entries[i].key == key && b.entries[i].remaining == remaining) {
+            replace = &b.entries[i];
+            break;
+        }
+        if (b.entries[i].work < replace->work) {
+            replace = &b.entries[i];
+        }
+    }
+    *replace = MateEntry{key, pn, dn, work, remaining};
+}
+
+void MateTable::clear() {
+    std::fill(buckets.begin(), buckets.end(), MateBucket());
+}
+
+
+MateSearch::MateSearch(Board b, MateTable& t, TimeHandler& th) : board(b), table(t), time_handler(th) {
+    nodes_searched = 0;
+    stopped = false;
+}
+
+U64 MateSearch::get_nodes_searched() {
+    return nodes_searched;
+}
+
+void MateSearch::evaluate_child(unsigned int remaining, unsigned int& pn, unsigned int& dn) {
+    // Proof and disproof numbers of the position after a move, from the table or a cheap first estimate
+    if (table.get(board.get_z_key(), remaining, pn, dn)) {
+        return;
+    }
+    bool is_in_check;
+    int mobility = board.calculate_mobility(is_in_check);
+    bool is_attacker = remaining % 2 == 1;
+    if (mobility == 0) {
+        // Checkmate is only a proof when the defender is the one mated
+        bool proven = is_in_check && !is_attacker;
+        pn = proven ? 0 : PN_INFINITY;
+        dn = proven ? PN_INFINITY : 0;
+    } else if (remaining == 0) {
+        // The depth bound was reached without mate; at the last attacking ply this rejects every non-checking move
+        pn = PN_INFINITY;
+        dn = 0;
+    } else if (is_attacker) {
+        pn = 1;
+        dn = 1;
+    } else {
+        // Every defender reply has to be refuted, so positions with fewer replies are cheaper to prove
+        pn = mobility;
+        dn = 1;
+    }
+}
+
+void MateSearch::mid(unsigned int remaining, unsigned int thpn, unsigned int thdn, unsigned int& pn,
+                     unsigned int& dn) {
+    // Expands the most proving node below this one until its numbers reach either threshold
+    // Attacker nodes (odd remaining) are OR nodes, defender nodes are AND nodes
+    U64 nodes_before = nodes_searched;
+    nodes_searched++;
+    if (time_handler.should_stop()) {
+        stopped = true;
+        return;
+    }
+
+    const bool is_or = remaining % 2 == 1;
+    MoveList moves;
+    board.generate_moves(moves);
+
+    std::vector<unsigned int> child_pn(moves.size()), child_dn(moves.size());
+    for (int i = 0; i < moves.size(); i++) {
+        board.make_move(moves[i]);
+        if (board.has_repeated_once()) {
+            // Repetitions are draws, which refute the mate
+            child_pn[i] = PN_INFINITY;
+            child_dn[i] = 0;
+        } else {
+            evaluate_child(remaining - 1, child_pn[i], child_dn[i]);
+        }
+        board.unmake_move();
+    }
+
+    while (true) {
+        // OR nodes need one proven child, AND nodes need all of them
+        unsigned int best = 0;
+        unsigned int second = PN_INFINITY;
+        pn = is_or ? PN_INFINITY : 0;
+        dn = is_or ? 0 : PN_INFINITY;
+        for (int i = 0; i < moves.size(); i++) {
+            unsigned int selector = is_or ? child_pn[i] : child_dn[i];
+            unsigned int best_selector = is_or ? child_pn[best] : child_dn[best];
+            if (is_or) {
+                pn = std::min(pn, child_pn[i]);
+                dn = saturating_add(dn, child_dn[i]);
+            } else {
+                pn = saturating_add(pn, child_pn[i]);
+                dn = std::min(dn, child_dn[i]);
+            }
+            if (i == 0) {
+                continue;
+            }
+            if (selector < best_selector) {
+                second = best_selector;
+                best = i;
+            } else if (selector < second) {
+                second = selector;
+            }
+        }
+
+        if (pn >= thpn || dn >= thdn || stopped) {
+            break;
+        }
+
+        unsigned int next_thpn, next_thdn;
+        if (is_or) {
+            next_thpn = std::min(thpn, saturating_add(second, 1));
+            next_thdn = saturating_add(thdn - dn, child_dn[best]);
+        } else {
+            next_thpn = saturating_add(thpn - pn, child_pn[best]);
+            next_thdn = std::min(thdn, saturating_add(second, 1));
+        }
+
+        board.make_move(moves[best]);
+        mid(remaining - 1, next_thpn, next_thdn, child_pn[best], child_dn[best]);
+        board.unmake_move();
+    }
+
+    if (!stopped) {
+        table.set(board.get_z_key(), remaining, pn, dn,
+                  (unsigned int) std::min(nodes_searched - nodes_before, (U64) UINT32_MAX));
+    }
+}
+
+std::vector<Move> MateSearch::get_mating_line(unsigned int remaining) {
+    // Follows proven children from the root; stops early if the table no longer holds the rest of the proof
+    std::vector<Move> line;
+    while (true) {
+        MoveList moves;
+        board.generate_moves(moves);
+        Move next;
+        for (int i = 0; i < moves.size() && next.get_raw_data() == 0; i++) {
+            unsigned int pn, dn;
+            board.make_move(moves[i]);
+            evaluate_child(remaining - 1, pn, dn);
+            board.unmake_move();
+            if (pn == 0) {
+                next = moves[i];
+            }
+        }
+        if (next.get_raw_data() == 0) {
+            break;
+        }
+        line.push_back(next);
+        board.make_move(next);
+        remaining--;
+    }
+    for (unsigned int i = 0; i < line.size(); i++) {
+        board.unmake_move();
+    }
+    return line;
+}
+
+Move MateSearch::most_promising_move(unsigned int remaining) {
+    MoveList moves;
+    board.generate_moves(moves);
+    Move best;
+    unsigned int best_pn = PN_INFINITY + 1;
+    for (int i = 0; i < moves.size(); i++) {
+        unsigned int pn, dn;
+        board.make_move(moves[i]);
+        evaluate_child(remaining - 1, pn, dn);
+        board.unmake_move();
+        if (pn < best_pn) {
+            best_pn = pn;
+            best = moves[i];
+        }
+    }
+    return best;
+}
+
+bool MateSearch::find_mate(unsigned int max_moves) {
+    time_handler.start();
+
+    MoveList moves;
+    board.generate_moves(moves);
+    if (moves.size() == 0) {
+        time_handler.stop();
+        return false;
+    }
+
+    // Shorter bounds first, so the first proof is also the shortest mate
+    for (unsigned int mate_moves = 1; mate_moves <= max_moves; mate_moves++) {
+        unsigned int remaining = 2 * mate_moves - 1;
+        unsigned int pn, dn;
+        mid(remaining, PN_INFINITY, PN_INFINITY, pn, dn);
+
+        if (stopped) {
+            // Stopped before a proof or disproof, play the move closest to being proven
+            Move best_move = most_promising_move(remaining);
+            std::ostringstream buffer;
+            buffer << "info string mate search stopped nodes " << nodes_searched << '\n';
+            buffer << "bestmove " << move_to_str(best_move, true) << '\n';
+            get_synced_cout().print(buffer.str());
+            time_handler.stop();
+            return true;
+        }
+
+        if (pn == 0) {
+            std::vector<Move> line = get_mating_line(remaining);
+            std::ostringstream buffer;
+            buffer << "info score mate " << mate_moves << " depth " << remaining << " nodes " << nodes_searched;
+            if (!line.empty()) {
+                buffer << " pv " << print_move_vector(line);
+            }
+            buffer << '\n';
+            buffer << "bestmove " << move_to_str(line.empty() ? most_promising_move(remaining) : line[0], true);
+            buffer << '\n';
+            get_synced_cout().print(buffer.str());
+            time_handler.stop();
+            return true;
+        }
+    }
+
+    std::ostringstream buffer;
+    buffer << "info string no mate in " << max_moves << " nodes " << nodes_searched << '\n';
+    get_synced_cout().print(buffer.str());
+    time_handler.stop();
+    return false;
+}
@@ -0,0 +1,79 @@
+//
+// Depth-bounded df-pn (depth-first proof-number) search for proving forced mates
+//
+
+#ifndef BITBOARD_CHESS_MATE_SEARCH_HPP
+#define BITBOARD_CHESS_MATE_SEARCH_HPP
+
+#include "depend.hpp"
+#include "Data_structs.hpp"
+#include "Board.hpp"
+#include "Time_handler.hpp"
+#include "Utility.hpp"
+#include "Search.hpp"
+
+#define MATE_HASH_DEFAULT_MB 16
+#define MATE_HASH_MAX_MB 1024
+#define MATE_BUCKET_SIZE 4
+
+// Proof and disproof numbers saturate here, a node with pn 0 is proven and one with dn 0 is disproven
+#define PN_INFINITY 100000000U
+
+
+struct MateEntry {
+    U64 key;
+    unsigned int pn;
+    unsigned int dn;
+    unsigned int work; // Nodes spent below this entry, the least worked entry of a bucket is replaced first
+    unsigned int remaining; // Plies left before the depth bound, part of the key
+};
+
+struct MateBucket {
+    MateEntry entries[MATE_BUCKET_SIZE];
+};
+
+// Proof and disproof numbers of positions, kept separately from the TT so mate proofs never evict search results
+class MateTable {
+private:
+    std::vector<MateBucket> buckets;
+    U64 lookup_mask;
+public:
+    explicit MateTable(unsigned int size_mb = MATE_HASH_DEFAULT_MB);
+
+    void resize(unsigned int size_mb);
+
+    bool get(U64 key, unsigned int remaining, unsigned int& pn, unsigned int& dn) const;
+
+    void set(U64 key, unsigned int remaining, unsigned int pn, unsigned int dn, unsigned int work);
+
+    void clear();
+};
+
+
+class MateSearch {
+private:
+    Board board;
+    MateTable& table;
+    TimeHandler& time_handler;
+    U64 nodes_searched;
+    bool stopped;
+
+    void evaluate_child(unsigned int remaining, unsigned int& pn, unsigned int& dn);
+
+    void mid(unsigned int remaining, unsigned int thpn, unsigned int thdn, unsigned int& pn, unsigned int& dn);
+
+    std::vector<Move> get_mating_line(unsigned int remaining);
+
+    Move most_promising_move(unsigned int remaining);
+
+public:
+    MateSearch(Board b, MateTable& t, TimeHandler& th);
+
+    // Looks for a mate in at most max_moves moves, printing the line and bestmove if one is proven
+    // Returns false without printing a bestmove if no such mate exists
+    bool find_mate(unsigned int max_moves);
+
+    U64 get_nodes_searched();
+};
+
+#endif //BITBOARD_CHESS_MATE_SEARCH_HPP
@@ -0,0 +1,302 @@
+//
+// Monte Carlo tree search with PUCT selection and virtual loss, each worker selecting several leaves per round
+//
+
+#include "Mcts_search.hpp"
+
+#include <cmath>
+
+void MctsNode::init(Move m, float p) {
+    move = m;
+    prior = p;
+    visits = 0;
+    virtual_loss = 0;
+    value_sum = 0;
+    first_child = MCTS_NO_NODE;
+    num_children = 0;
+    state = mcts_unexpanded;
+}
+
+MctsArena::MctsArena() {
+    used = 0;
+}
+
+void MctsArena::reset() {
+    if (!nodes) {
+        nodes.reset(new MctsNode[MCTS_ARENA_NODES]);
+    }
+    used = 0;
+}
+
+unsigned int MctsArena::allocate(unsigned int count) {
+    // Workers allocate concurrently; a request that doesn't fit leaves used untouched, so a full arena stays full
+    // rather than creeping towards a wrap around with every failed expansion
+    unsigned int index = used.load();
+    do {
+        if ((U64) index + count > MCTS_ARENA_NODES) {
+            return MCTS_NO_NODE;
+        }
+    } while (!used.compare_exchange_weak(index, index + count));
+    return index;
+}
+
+MctsNode& MctsArena::operator[](unsigned int index) {
+    return nodes[index];
+}
+
+unsigned int MctsArena::size() {
+    return std::min((unsigned int) used, MCTS_ARENA_NODES);
+}
+
+
+MctsSearch::MctsSearch(Board b, TT& t, OpeningBook& ob, TimeHandler& th, MctsArena& a) : board(b), tt(t),
+                                                                                       opening_book(ob),
+                                                                                       time_handler(th), arena(a) {
+    num_threads = 1;
+    node_limit = 0;
+    playouts = 0;
+    max_tree_depth = 0;
+    root = MCTS_NO_NODE;
+}
+
+void MctsSearch::set_threads(unsigned int n) {
+    num_threads = std::max(1U, n);
+}
+
+void MctsSearch::set_node_limit(U64 n) {
+    node_limit = n;
+}
+
+bool MctsSearch::should_stop() {
+    return time_handler.should_stop() || (node_limit && playouts >= node_limit);
+}
+
+static inline double node_value(MctsNode& node, int& visits) {
+    // Mean value including virtual losses, which make workers spread out over the tree
+    int virtual_loss = node.virtual_loss;
+    visits = node.visits + virtual_loss;
+    return ((double) node.value_sum / MCTS_VALUE_FIXED_POINT - virtual_loss) / std::max(visits, 1);
+}
+
+unsigned int MctsSearch::select_child(unsigned int parent) {
+    MctsNode& parent_node = arena[parent];
+    int parent_visits;
+    // The parent's value is from the other side's view
+    double fpu = (parent == root ? 0.0 : -node_value(parent_node, parent_visits)) - MCTS_FPU_REDUCTION;
+    parent_visits = parent_node.visits + parent_node.virtual_loss;
+    double exploration = MCTS_CPUCT * std::sqrt((double) std::max(parent_visits, 1));
+
+    unsigned int first = parent_node.first_child;
+    unsigned int best = first;
+    double best_score = -1e9;
+    for (unsigned int i = first; i < first + parent_node.num_children; i++) {
+        int visits;
+        double q = node_value(arena[i], visits);
+        if (visits == 0) {
+            q = fpu;
+        }
+        double score = q + exploration * arena[i].prior / (1 + visits);
+        if (score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+void MctsSearch::expand(unsigned int node, Search& search) {
+    // The caller owns the node (state mcts_expanding) and the board is at its position
+    Board& b = search.get_board();
+    MoveList moves;
+    // Draws below the root are terminal, the root itself is searched even if it already repeats
+    if (node == root || (!b.has_repeated_once() && !b.has_drawn_by_fifty_move_rule())) {
+        b.generate_moves(moves);
+    }
+
+    unsigned int first = moves.size() ? arena.allocate(moves.size()) : MCTS_NO_NODE;
+    if (moves.size() && first == MCTS_NO_NODE) {
+        // Out of nodes, leave it as a leaf that is evaluated on every visit
+        arena[node].state = mcts_unexpanded;
+        return;
+    }
+
+    // Priors are a softmax over the alpha-beta move ordering scores
+    Move killers[2];
+    search.assign_move_scores(moves, HashMove(), killers);
+    std::vector<double> weights(moves.size());
+    double total = 0;
+    for (int i = 0; i < moves.size(); i++) {
+        weights[i] = std::exp(((double) moves[i].get_move_score() - 512) / MCTS_PRIOR_TEMPERATURE);
+        total += weights[i];
+    }
+    for (int i = 0; i < moves.size(); i++) {
+        arena[first + i].init(moves[i], (float) (weights[i] / total));
+    }
+
+    arena[node].first_child = first;
+    arena[node].num_children = moves.size();
+    arena[node].state = mcts_expanded;
+}
+
+double MctsSearch::evaluate_leaf(Search& search) {
+    // Value of the leaf from the view of its side to move, in [-1, 1]
+    Board& b = search.get_board();
+    if (b.has_repeated_once() || b.has_drawn_by_fifty_move_rule()) {
+        return 0;
+    }
+    bool is_in_check;
+    if (b.calculate_mobility(is_in_check) == 0) {
+        return is_in_check ? -1 : 0;
+    }
+    int eval = MCTS_USE_QSEARCH ? search.quiescence_search(0, -MAXMATE, MAXMATE, 0) : b.static_eval();
+    return std::tanh(eval / MCTS_VALUE_SCALE);
+}
+
+void MctsSearch::backpropagate(const std::vector<unsigned int>& path, double value) {
+    // value is from the view of the side to move at the leaf, which is the opponent of whoever moved into it
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        value = -value;
+        MctsNode& node = arena[*it];
+        node.value_sum += (long long) (value * MCTS_VALUE_FIXED_POINT);
+        node.visits++;
+        node.virtual_loss--;
+    }
+}
+
+void MctsSearch::worker(bool is_main) {
+    // Only evaluates leaves and orders moves, never runs find_best_move, so it never allocates the continuation history
+    Search search(board, tt, opening_book, time_handler);
+    Board& b = search.get_board();
+    auto start_time = std::chrono::steady_clock::now();
+    auto last_info = start_time;
+
+    std::vector<std::vector<unsigned int>> leaves;
+    while (!should_stop()) {
+        leaves.clear();
+
+        // Selection: descend to MCTS_LEAVES_PER_ROUND leaves, marking each path with virtual loss
+        for (unsigned int i = 0; i < MCTS_LEAVES_PER_ROUND; i++) {
+            std::vector<unsigned int> path(1, root);
+            arena[root].virtual_loss++;
+            unsigned int node = root;
+            while (arena[node].state == mcts_expanded && arena[node].num_children > 0) {
+                node = select_child(node);
+                arena[node].virtual_loss++;
+                b.make_move(arena[node].move);
+                path.push_back(node);
+            }
+
+            // Whoever gets to mark the leaf expands it, later arrivals just evaluate it again
+            int expected = mcts_unexpanded;
+            if (arena[node].state.compare_exchange_strong(expected, mcts_expanding)) {
+                expand(node, search);
+            }
+
+            for (unsigned int j = 1; j < path.size(); j++) {
+                b.unmake_move();
+            }
+            leaves.push_back(path);
+        }
+
+        // Evaluation and backup of this round's leaves, one at a time
+        for (auto path = leaves.begin(); path != leaves.end(); ++path) {
+            for (unsigned int j = 1; j < path->size(); j++) {
+                b.make_move(arena[(*path)[j]].move);
+            }
+            double value = evaluate_leaf(search);
+            for (unsigned int j = 1; j < path->size(); j++) {
+                b.unmake_move();
+            }
+            backpropagate(*path, value);
+            playouts++;
+
+            unsigned int depth = path->size() - 1;
+            unsigned int current_max = max_tree_depth;
+            while (depth > current_max && !max_tree_depth.compare_exchange_weak(current_max, depth));
+        }
+
+        if (is_main) {
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<double, std::milli>(now - last_info).count() >= MCTS_INFO_INTERVAL_MS) {
+                log_search_info(start_time);
+                last_info = now;
+            }
+        }
+    }
+}
+
+unsigned int MctsSearch::best_child(unsigned int node) {
+    unsigned int first = arena[node].first_child;
+    unsigned int best = first;
+    for (unsigned int i = first; i < first + arena[node].num_children; i++) {
+        if (arena[i].visits > arena[best].visits) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+std::vector<Move> MctsSearch::get_pv() {
+    std::vector<Move> pv;
+    unsigned int node = root;
+    while (arena[node].state == mcts_expanded && arena[node].num_children > 0) {
+        node = best_child(node);
+        if (arena[node].visits == 0) {
+            break;
+        }
+        pv.push_back(arena[node].move);
+    }
+    return pv;
+}
+
+void MctsSearch::log_search_info(std::chrono::steady_clock::time_point start_time) {
+    std::vector<Move> pv = get_pv();
+    if (pv.empty()) {
+        return;
+    }
+    int visits;
+    double q = node_value(arena[best_child(root)], visits);
+    q = std::max(-0.999, std::min(q, 0.999));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::ostringstream buffer;
+    buffer << "info score cp " << (int) (MCTS_VALUE_SCALE * std::atanh(q));
+    buffer << " depth " << pv.size() << " seldepth " << max_tree_depth;
+    buffer << " nodes " << playouts << " nps " << (U64) (playouts / (ms / 1000 + 1e-9));
+    buffer << " pv " << print_move_vector(pv) << '\n';
+    get_synced_cout().print(buffer.str());
+}
+
+Move MctsSearch::find_best_move() {
+    auto start_time = std::chrono::steady_clock::now();
+    time_handler.start();
+    arena.reset();
+    playouts = 0;
+    max_tree_depth = 0;
+
+    MoveList moves;
+    board.generate_moves(moves);
+    if (moves.size() <= 1) {
+        Move best_move = moves.size() ? moves[0] : Move();
+        get_synced_cout().print("bestmove " + move_to_str(best_move, true) + '\n');
+        time_handler.stop();
+        return best_move;
+    }
+
+    root = arena.allocate(1);
+    arena[root].init(Move(), 1);
+
+    // Helpers search until the main worker sees the stop condition too
+    Thread::TaskGroup helpers;
+    for (unsigned int i = 1; i < num_threads; i++) {
+        helpers.run(get_thread_pool(), [this] { worker(false); });
+    }
+    worker(true);
+    time_handler.stop();
+    helpers.wait();
+
+    log_search_info(start_time);
+    Move best_move = arena[best_child(root)].move;
+    get_synced_cout().print("bestmove " + move_to_str(best_move, true) + '\n');
+    return best_move;
+}
@@ -0,0 +1,113 @@
+//
+// Monte Carlo tree search with PUCT selection and virtual loss, each worker selecting several leaves per round
+//
+
+#ifndef BITBOARD_CHESS_MCTS_SEARCH_HPP
+#define BITBOARD_CHESS_MCTS_SEARCH_HPP
+
+#include "depend.hpp"
+#include "Data_structs.hpp"
+#include "Board.hpp"
+#include "Search.hpp"
+#include "Transposition_table.hpp"
+#include "Opening_book.hpp"
+#include "Time_handler.hpp"
+#include "Thread.hpp"
+#include "Utility.hpp"
+
+#include <memory>
+
+#define MCTS_ARENA_NODES (1U << 22) // Nodes preallocated for the tree, expansion stops once they run out
+#define MCTS_LEAVES_PER_ROUND 8 // Leaves a worker selects under virtual loss before evaluating and backing them up
+#define MCTS_CPUCT 1.5
+#define MCTS_FPU_REDUCTION 0.2 // Unvisited children are valued this much below their parent
+#define MCTS_PRIOR_TEMPERATURE 32.0 // Move ordering score difference that makes a prior e times larger
+#define MCTS_VALUE_SCALE 300.0 // Leaf values are tanh(centipawns / MCTS_VALUE_SCALE)
+#define MCTS_USE_QSEARCH 1 // Use quiescence_search for leaf values, static_eval otherwise
+#define MCTS_VALUE_FIXED_POINT 10000 // Values are summed as integers so workers can update them atomically
+#define MCTS_INFO_INTERVAL_MS 1000
+
+#define MCTS_NO_NODE 0xFFFFFFFF
+
+enum MctsNodeState {
+    mcts_unexpanded,
+    mcts_expanding,
+    mcts_expanded,
+};
+
+struct MctsNode {
+    Move move; // Move leading to this node
+    float prior;
+    std::atomic<int> visits;
+    std::atomic<int> virtual_loss; // Workers currently below this node, each counted as a lost visit
+    std::atomic<long long> value_sum; // From the view of the side that played move, in MCTS_VALUE_FIXED_POINT units
+    std::atomic<unsigned int> first_child; // Children are allocated contiguously
+    std::atomic<unsigned int> num_children;
+    std::atomic<int> state;
+
+    void init(Move m, float p);
+};
+
+// Pool the tree is allocated from, so a search never calls new per node
+class MctsArena {
+private:
+    std::unique_ptr<MctsNode[]> nodes;
+    std::atomic<unsigned int> used;
+public:
+    MctsArena();
+
+    // Allocates the pool on first use and empties it
+    void reset();
+
+    // Index of the first of count consecutive nodes, MCTS_NO_NODE if the arena is full
+    unsigned int allocate(unsigned int count);
+
+    MctsNode& operator[](unsigned int index);
+
+    unsigned int size();
+};
+
+
+class MctsSearch {
+private:
+    Board board;
+    TT& tt;
+    OpeningBook& opening_book;
+    TimeHandler& time_handler;
+    MctsArena& arena;
+    unsigned int num_threads;
+    U64 node_limit;
+    std::atomic<U64> playouts;
+    std::atomic<unsigned int> max_tree_depth;
+    unsigned int root;
+
+    bool should_stop();
+
+    unsigned int select_child(unsigned int parent);
+
+    void expand(unsigned int node, Search& search);
+
+    double evaluate_leaf(Search& search);
+
+    void backpropagate(const std::vector<unsigned int>& path, double value);
+
+    void worker(bool is_main);
+
+    unsigned int best_child(unsigned int node);
+
+    std::vector<Move> get_pv();
+
+    void log_search_info(std::chrono::steady_clock::time_point start_time);
+
+public:
+    MctsSearch(Board b, TT& t, OpeningBook& ob, TimeHandler& th, MctsArena& a);
+
+    void set_threads(unsigned int n);
+
+    // Stops after this many playouts, 0 for no limit
+    void set_node_limit(U64 n);
+
+    Move find_best_move();
+};
+
+#endif //BITBOARD_CHESS_MCTS_SEARCH_HPP
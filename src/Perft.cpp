@@ -0,0 +1,194 @@
+//
+// Move generator node counts for go perft
+//
+
+#include "Perft.hpp"
+
+PerftTable::PerftTable(unsigned int size_mb) {
+    resize(size_mb);
+}
+
+void PerftTable::resize(unsigned int size_mb) {
+    size_mb = std::min(size_mb, (unsigned int) PERFT_HASH_MAX_MB);
+    if (size_mb == 0) {
+        std::vector<PerftBucket>().swap(buckets);
+        lookup_mask = 0;
+        return;
+    }
+    // Largest power of two number of buckets that fits in size_mb
+    U64 num_buckets = 1;
+    while (num_buckets * 2 * sizeof(PerftBucket) <= (U64) size_mb << 20) {
+        num_buckets *= 2;
+    }
+    buckets.assign(num_buckets, PerftBucket());
+    lookup_mask = num_buckets - 1;
+}
+
+bool PerftTable::is_enabled() const {
+    return !buckets.empty();
+}
+
+bool PerftTable::get(U64 key, unsigned int depth, U64& nodes) const {
+    const PerftBucket& b = buckets[key & lookup_mask];
+    for (int i = 0; i < PERFT_BUCKET_SIZE; i++) {
+        U64 data = b.entries[i].data;
+        if ((b.entries[i].key ^ data) == key && data >> PERFT_COUNT_BITS == depth) {
+            nodes = data & PERFT_COUNT_MASK;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerftTable::set(U64 key, unsigned int depth, U64 nodes) {
+    // The shallowest entry is replaced first, since it is the cheapest to count again
+    PerftBucket& b = buckets[key & lookup_mask];
+    PerftEntry* replace = &b.entries[0];
+    for (int i = 0; i < PERFT_BUCKET_SIZE; i++) {
+        U64 data = b.entries[i].data;
+        if ((b.entries[i].key ^ data) == key) {
+            replace = &b.entries[i];
+            break;
+        }
+        if (data >> PERFT_COUNT_BITS < replace->data >> PERFT_COUNT_BITS) {
+            replace = &b.entries[i];
+        }
+    }
+    U64 data = ((U64) depth << PERFT_COUNT_BITS) | nodes;
+    replace->key = key ^ data;
+    replace->data = data;
+}
+
+void PerftTable::clear() {
+    std::fill(buckets.begin(), buckets.end(), PerftBucket());
+}
+
+
+U64 perft(Board& board, unsigned int depth, PerftTable* table) {
+    if (depth == 0) {
+        return 1;
+    }
+    if (depth == 1) {
+        return board.calculate_mobility();
+    }
+
+    U64 nodes = 0;
+    bool use_table = table && depth >= PERFT_HASH_MIN_DEPTH;
+    if (use_table && table->get(board.get_z_key(), depth, nodes)) {
+        return nodes;
+    }
+
+    MoveList moves;
+    board.generate_moves(moves);
+
+    for (auto it = moves.begin(); it != moves.end(); ++it) {
+        board.make_move(*it);
+        nodes += perft(board, depth - 1, table);
+        board.unmake_move();
+    }
+
+    if (use_table) {
+        table->set(board.get_z_key(), depth, nodes);
+    }
+    return nodes;
+}
+
+U64 perft_divide(Board& board, unsigned int depth, PerftTable& table) {
+    Thread::ThreadPool& pool = get_thread_pool();
+    PerftTable* table_used = table.is_enabled() ? &table : nullptr;
+
+    MoveList moves;
+    board.generate_moves(moves);
+
+    // Splitting also keeps tasks short enough for the progress reports of deep runs to come regularly
+    bool split = depth >= PERFT_SPLIT_MIN_DEPTH;
+
+    // One count per task: a root move's replies when split, otherwise just the root move
+    std::vector<std::vector<U64>> counts(moves.size());
+    Thread::TaskGroup tasks;
+
+    // Progress of the tasks finished so far, reported by whichever task finishes once the interval has passed
+    std::mutex progress_lock;
+    unsigned int tasks_total = 0;
+    unsigned int tasks_done = 0;
+    U64 nodes_done = 0;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto last_report = t1;
+
+    auto report_task = [&](U64 nodes) {
+        std::lock_guard<std::mutex> lock(progress_lock);
+        tasks_done++;
+        nodes_done += nodes;
+        auto now = std::chrono::high_resolution_clock::now();
+        if (now - last_report >= std::chrono::milliseconds(PERFT_PROGRESS_INTERVAL_MS)) {
+            last_report = now;
+            std::chrono::duration<double, std::milli> ms_double = now - t1;
+            std::ostringstream buffer;
+            buffer << "info string perft tasks " << tasks_done << '/' << tasks_total << " nodes " << nodes_done
+                   << " time " << (U64) ms_double.count() << " nps "
+                   << (U64) (nodes_done / (ms_double.count() / 1000 + 1e-9)) << '\n';
+            get_synced_cout().print(buffer.str());
+        }
+    };
+
+    auto run_task = [&](Board child, unsigned int child_depth, U64* count) {
+        tasks.run(pool, [child, child_depth, count, table_used, &report_task]() mutable {
+            *count = perft(child, child_depth, table_used);
+            report_task(*count);
+        });
+    };
+
+    // Sized up front so that progress reports know how many tasks there are
+    for (int i = 0; i < moves.size(); i++) {
+        if (split) {
+            board.make_move(moves[i]);
+            counts[i].resize(board.calculate_mobility());
+            board.unmake_move();
+        } else {
+            counts[i].resize(1);
+        }
+        tasks_total += counts[i].size();
+    }
+
+    for (int i = 0; i < moves.size(); i++) {
+        board.make_move(moves[i]);
+
+        if (split) {
+            MoveList replies;
+            board.generate_moves(replies);
+
+            for (int j = 0; j < replies.size(); j++) {
+                board.make_move(replies[j]);
+                run_task(board, depth - 2, &counts[i][j]);
+                board.unmake_move();
+            }
+        } else {
+            run_task(board, depth - 1, &counts[i][0]);
+        }
+
+        board.unmake_move();
+    }
+
+    tasks.wait();
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+
+    U64 perft_sum = 0;
+    std::ostringstream buffer;
+    for (int i = 0; i < moves.size(); i++) {
+        U64 perft_score = 0;
+        for (U64 count : counts[i]) {
+            perft_score += count;
+        }
+        perft_sum += perft_score;
+        buffer << move_to_str(moves[i], true) << ": " << perft_score << '\n';
+    }
+
+    buffer << "\nNodes Searched: " << perft_sum << '\n';
+    buffer << "Time: " << ms_double.count() << "ms\n";
+    buffer << "NPS: " << (U64) (perft_sum / (ms_double.count() / 1000 + 1e-9)) << "\n\n";
+    get_synced_cout().print(buffer.str());
+
+    return perft_sum;
+}
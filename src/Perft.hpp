@@ -0,0 +1,61 @@
+//
+// Move generator node counts for go perft
+//
+
+#ifndef BITBOARD_CHESS_PERFT_HPP
+#define BITBOARD_CHESS_PERFT_HPP
+
+#include "depend.hpp"
+#include "Board.hpp"
+#include "Thread.hpp"
+
+#define PERFT_SPLIT_MIN_DEPTH 5 // From this depth every reply to a root move is its own task, for load balance
+#define PERFT_HASH_MAX_MB 16384 // The default of 0 leaves go perft a pure move generator benchmark
+#define PERFT_BUCKET_SIZE 4
+#define PERFT_HASH_MIN_DEPTH 2 // Counts of depth 1 are cheaper to redo in bulk than to look up
+#define PERFT_PROGRESS_INTERVAL_MS 10000
+
+#define PERFT_COUNT_BITS 56 // An entry's data holds the count in these lower bits and the depth above them
+#define PERFT_COUNT_MASK ((C64(1) << PERFT_COUNT_BITS) - 1)
+
+
+struct PerftEntry {
+    U64 key; // Full Zobrist key xored with data, so an entry torn by two threads writing at once never matches
+    U64 data;
+};
+
+struct PerftBucket {
+    PerftEntry entries[PERFT_BUCKET_SIZE];
+};
+
+// Leaf counts of positions at a given depth, kept apart from the TT so they get full keys and 64 bit counts
+// Counts never go stale, so the table is kept between go perft commands
+class PerftTable {
+private:
+    std::vector<PerftBucket> buckets;
+    U64 lookup_mask;
+public:
+    explicit PerftTable(unsigned int size_mb = 0);
+
+    // A size of 0 frees the table and turns perft hashing off
+    void resize(unsigned int size_mb);
+
+    bool is_enabled() const;
+
+    bool get(U64 key, unsigned int depth, U64& nodes) const;
+
+    void set(U64 key, unsigned int depth, U64 nodes);
+
+    void clear();
+};
+
+// Number of leaves depth plies below the board, without building a Search
+// The last ply is counted in bulk by calculate_mobility rather than made and unmade move by move
+U64 perft(Board& board, unsigned int depth, PerftTable* table = nullptr);
+
+// Counts the leaves below each root move on the thread pool, each task on its own copy of the board
+// The per move counts are printed in move generation order once every task has finished, with progress reports
+// in between for long runs
+U64 perft_divide(Board& board, unsigned int depth, PerftTable& table);
+
+#endif //BITBOARD_CHESS_PERFT_HPP
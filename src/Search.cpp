@@ -8,28 +8,26 @@
 
 #include "Search.hpp"
 
-unsigned int lmr_values[256];
+#include <cmath>
 
-int type2collision;
+unsigned int lmr_table[MAX_DEPTH + 1][256];
+
+thread_local int type2collision;
 
 void init_search() {
-    for (unsigned int i = 0; i < 256; i++) {
-        if (i < 3) {
-            lmr_values[i] = 0;
-        }
-        /*
-        else if (i >= 2 && i < 8) {
-            lmr_values[i] = i / 4;
-        }
-            */
-        else {
-            lmr_values[i] = 1;
+    for (unsigned int depth = 0; depth <= MAX_DEPTH; depth++) {
+        for (unsigned int move_count = 0; move_count < 256; move_count++) {
+            if (depth == 0 || move_count < LMR_MIN_MOVES) {
+                lmr_table[depth][move_count] = 0;
+            } else {
+                lmr_table[depth][move_count] = (unsigned int) (LMR_BASE + log(depth) * log(move_count) / LMR_DIVISOR);
+            }
         }
     }
 
     /*
     for (unsigned int i = 0; i < 256; i++) {
-        std::cout << lmr_values[i] << '\n';
+        std::cout << lmr_table[8][i] << '\n';
     }
     */
 
@@ -38,14 +36,28 @@ void init_search() {
 MovePicker::MovePicker(MoveList& init_moves) : moves(init_moves) {
     size = init_moves.size();
     visit_count = 0;
+    deferred_count = 0;
+    deferred_visits = 0;
 }
 
 
 inline int MovePicker::finished() {
-    return visit_count == size;
+    return visit_count == size && deferred_visits == deferred_count;
+}
+
+inline void MovePicker::defer(Move move) {
+    deferred[deferred_count++] = move;
+}
+
+inline bool MovePicker::is_revisit() {
+    return visit_count == size && deferred_visits > 0;
 }
 
 inline Move MovePicker::operator++() {
+    if (visit_count == size) {
+        return deferred[deferred_visits++];
+    }
+
     unsigned int highest_score = 0;
     int highest_index = 0;
 
@@ -63,11 +75,127 @@ inline Move MovePicker::operator++() {
 
 Search::Search(Board b, TT& t, OpeningBook& ob, TimeHandler& th) : board(b), tt(t), opening_book(ob), time_handler(th) {
     nodes_searched = 0;
+    clear_history();
+    multi_pv = 1;
+    node_limit = 0;
+    mate_limit = 0;
+    root_driver = aspiration_windows;
+    debug = false;
+    silent = false;
+    thread_id = 0;
+    num_threads = 1;
+    parallel_mode = lazy_smp;
+    main_thread = this;
+    working_split = nullptr;
+    published_nodes = 0;
+    finished_helper_nodes = 0;
+    finished_helper_tt_probes = 0;
+    finished_helper_tt_hits = 0;
+    nmp_verifying = false;
+}
+
+void Search::clear_history() {
+    for (int turn = 0; turn < 2; turn++) {
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                history_moves[turn][y][x] = 0;
+            }
+        }
+        for (int piece = 0; piece < 8; piece++) {
+            for (int to = 0; to < 64; to++) {
+                counter_moves[turn][piece][to] = Move();
+                for (int captured = 0; captured < 8; captured++) {
+                    capture_history[turn][piece][to][captured] = 0;
+                }
+            }
+        }
+    }
+    std::fill(continuation_history[0].begin(), continuation_history[0].end(), 0);
+    std::fill(continuation_history[1].begin(), continuation_history[1].end(), 0);
+}
+
+Board& Search::get_board() {
+    return board;
+}
+
+void Search::set_multi_pv(unsigned int n) {
+    multi_pv = std::max(1U, std::min(n, (unsigned int) MAX_MULTI_PV));
+}
+
+void Search::set_node_limit(U64 n) {
+    node_limit = n;
+}
+
+void Search::set_mate_limit(unsigned int n) {
+    mate_limit = n;
+}
+
+void Search::set_search_moves(std::vector<Move> m) {
+    search_moves = m;
+}
+
+void Search::set_debug(bool b) {
+    debug = b;
+}
+
+void Search::set_root_driver(RootDriver d) {
+    root_driver = d;
+}
+
+void Search::set_silent(bool b) {
+    silent = b;
+}
+
+void Search::set_iteration_callback(std::function<void(unsigned int, Move, int)> f) {
+    iteration_callback = f;
+}
+
+U64 Search::get_nodes_searched() {
+    return nodes_searched;
+}
+
+U64 Search::get_total_nodes() {
+    U64 total = nodes_searched + finished_helper_nodes;
+    for (auto it = helpers.begin(); it != helpers.end(); ++it) {
+        total += (*it)->published_nodes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+U64 Search::get_published_total_nodes() {
+    U64 total = published_nodes.load(std::memory_order_relaxed) + finished_helper_nodes;
+    for (auto it = helpers.begin(); it != helpers.end(); ++it) {
+        total += (*it)->published_nodes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double Search::get_tt_hit_rate() {
+    U64 probes = stats.tt_probes + finished_helper_tt_probes;
+    return probes ? (double) (stats.tt_hits + finished_helper_tt_hits) / probes : 0;
+}
+
+void Search::set_threads(unsigned int n) {
+    num_threads = std::max(1U, std::min(n, (unsigned int) MAX_THREADS));
+}
+
+void Search::set_parallel_mode(ParallelMode m) {
+    parallel_mode = m;
+}
+
+bool Search::should_stop() {
+    // The node limit is checked at the same points as the clock so fixed node searches are reproducible
+    // With helpers it counts the nodes of every thread, and helpers stop on it too
+    published_nodes.store(nodes_searched, std::memory_order_relaxed);
+    return time_handler.should_stop() ||
+           (node_limit && main_thread->get_published_total_nodes() >= node_limit) ||
+           (working_split && working_split->stop_work.load(std::memory_order_relaxed));
 }
 
 template<bool use_history_heuristic>
-void Search::assign_move_scores(MoveList& moves, HashMove hash_move, Move killers[2]) {
+void Search::assign_move_scores(MoveList& moves, HashMove hash_move, Move killers[2], unsigned int ply_from_root) {
     unsigned int score;
+    Move counter_move = use_history_heuristic ? get_counter_move(ply_from_root) : Move();
 
     // Score all the moves
     for (auto it = moves.begin(); it != moves.end(); ++it) {
@@ -79,13 +207,17 @@ void Search::assign_move_scores(MoveList& moves, HashMove hash_move, Move killer
         }
 
         if (it->is_capture()) {
-            score += 70;
-            score += board.static_exchange_eval(*it) / 8;
+            int hist_score = capture_history_entry(*it) / CAPTURE_HISTORY_ORDER_DIVISOR;
+            score += CAPTURE_ORDER_BASE + piece_to_value[it->get_piece_captured()] / CAPTURE_MVV_DIVISOR;
+            score += std::max(-CAPTURE_HISTORY_ORDER_LIMIT, std::min(hist_score, CAPTURE_HISTORY_ORDER_LIMIT));
         } else if (killers[0] == (*it) || killers[1] == (*it)) {
             score += 65;
+        } else if (use_history_heuristic && counter_move == (*it)) {
+            score += 58;
         } else if (use_history_heuristic) {
-            unsigned int hist_lookup = history_moves[board.get_current_turn()][it->get_from()][it->get_to()];
-            score += bitscan_reverse(hist_lookup) * !!hist_lookup; // Takes a base2 log of hist_lookup
+            // Keeps quiets between 464 and 560, below killers and counter moves
+            int hist_score = quiet_history(board.get_current_turn(), *it, ply_from_root) / HISTORY_ORDER_DIVISOR;
+            score += std::max(-48, std::min(hist_score, 48));
         }
 
         if (it->get_special_flag() == MOVE_PROMOTION) {
@@ -105,6 +237,10 @@ void Search::assign_move_scores(MoveList& moves, HashMove hash_move, Move killer
     }
 }
 
+// Only used from other files (MCTS priors), so it has to be instantiated here
+template void Search::assign_move_scores<false>(MoveList& moves, HashMove hash_move, Move killers[2],
+                                                unsigned int ply_from_root);
+
 template<bool use_delta_pruning>
 void Search::assign_move_scores_quiescent(MoveList& moves, int eval, int alpha) {
     unsigned int score;
@@ -115,39 +251,121 @@ void Search::assign_move_scores_quiescent(MoveList& moves, int eval, int alpha)
 
         int mvv_lva_result = Board::mvv_lva(*it);
 
+        // SEE is only needed to prune captures that might lose material, the rest are ordered by victim and history
         if (mvv_lva_result >= 0) {
             // Delta Pruning
-            if (!use_delta_pruning || eval + mvv_lva_result + 2 * PAWN_VALUE > alpha) {
-                score += mvv_lva_result / 8;
-            } else {
-                score = PRUNE_MOVE_SCORE;
-            }
-        } else {
-            int see_result = board.static_exchange_eval(*it);
-            if (see_result >= 0 /*&& (!use_delta_pruning || eval + see_result + 2*PAWN_VALUE > alpha)*/) {
-                score += see_result / 8;
-            } else {
-                score = PRUNE_MOVE_SCORE;
+            if (use_delta_pruning && eval + mvv_lva_result + 2 * PAWN_VALUE <= alpha) {
+                it->set_move_score(PRUNE_MOVE_SCORE);
+                continue;
             }
+        } else if (board.static_exchange_eval(*it) < 0) {
+            it->set_move_score(PRUNE_MOVE_SCORE);
+            continue;
         }
 
+        int hist_score = capture_history_entry(*it) / CAPTURE_HISTORY_ORDER_DIVISOR;
+        score += piece_to_value[it->get_piece_captured()] / CAPTURE_MVV_DIVISOR;
+        score += std::max(-CAPTURE_HISTORY_ORDER_LIMIT, std::min(hist_score, CAPTURE_HISTORY_ORDER_LIMIT));
+
         assert(score <= 1023);
         it->set_move_score(score);
     }
 }
 
+void Search::order_root_moves(MoveList& moves, HashMove best_move) {
+    // Moves whose subtrees took the most effort last iteration are the likeliest alternatives, so search them first
+    // Scores count down from just below the hash move, so MovePicker keeps this exact order
+    std::vector<std::pair<U64, int>> effort;
+    for (int i = 0; i < moves.size(); i++) {
+        U64 nodes = 0;
+        for (auto it = root_node_counts.begin(); it != root_node_counts.end(); ++it) {
+            if (it->first == moves[i]) {
+                nodes = it->second;
+                break;
+            }
+        }
+        effort.push_back(std::make_pair(nodes, i));
+    }
+    std::stable_sort(effort.begin(), effort.end(), [](const std::pair<U64, int>& a, const std::pair<U64, int>& b) {
+        return a.first > b.first;
+    });
+
+    for (unsigned int rank = 0; rank < effort.size(); rank++) {
+        Move& move = moves[effort[rank].second];
+        move.set_move_score(best_move == move ? 1000 : 999 - rank);
+    }
+}
+
+void Search::record_root_nodes(Move move, U64 nodes) {
+    for (auto it = root_node_counts.begin(); it != root_node_counts.end(); ++it) {
+        if (it->first == move) {
+            it->second = nodes;
+            return;
+        }
+    }
+    root_node_counts.push_back(std::make_pair(move, nodes));
+}
+
+void Search::log_root_info(int depth) {
+    // Debug only: shows how well the root was ordered and where the effort went
+    std::vector<std::pair<Move, U64>> counts = root_node_counts;
+    std::stable_sort(counts.begin(), counts.end(), [](const std::pair<Move, U64>& a, const std::pair<Move, U64>& b) {
+        return a.second > b.second;
+    });
+
+    std::ostringstream buffer;
+    buffer << "info string root depth " << depth;
+    buffer << " bestindex " << root_best_index;
+    buffer << " laterfh " << root_later_fail_highs << '/' << root_later_moves;
+    buffer << " nodes";
+    for (auto it = counts.begin(); it != counts.end(); ++it) {
+        buffer << ' ' << move_to_str(it->first, true) << ':' << it->second;
+    }
+    buffer << '\n';
+    get_synced_cout().print(buffer.str());
+}
+
+void Search::log_search_stats() {
+    std::ostringstream buffer;
+    buffer << "info string stats";
+    buffer << " lmr " << stats.lmr_reductions;
+    buffer << " lmrresearch " << stats.lmr_researches;
+    buffer << " lmp " << stats.lmp_pruned;
+    buffer << " histprune " << stats.history_pruned;
+    buffer << " rfp " << stats.rfp_cutoffs;
+    buffer << " razor " << stats.razor_cutoffs;
+    buffer << " futility " << stats.futility_pruned;
+    buffer << " nmp " << stats.nmp_cutoffs << '/' << stats.nmp_tries;
+    buffer << " nmpverifyfail " << stats.nmp_verify_failures;
+    buffer << " singular " << stats.se_extensions << '/' << stats.se_tries;
+    buffer << " multicut " << stats.multicut_cutoffs;
+    buffer << " probcut " << stats.probcut_cutoffs << '/' << stats.probcut_tries;
+    buffer << " iid " << stats.iid_searches;
+    buffer << " iir " << stats.iir_reductions;
+    buffer << " seeprune " << stats.see_pruned;
+    buffer << " firstcut " << stats.first_move_cutoffs << '/' << stats.beta_cutoffs;
+    buffer << " tthit " << stats.tt_hits << '/' << stats.tt_probes;
+    buffer << '\n';
+    get_synced_cout().print(buffer.str());
+}
+
 std::vector<Move> Search::get_pv() {
+    // MTD(f) only ever searches null windows, so below the root it leaves bound entries and no exact ones
+    // Their moves are followed as well then, each checked for legality as a bound entry may come from another line
+    bool follow_bounds = root_driver == mtdf;
     std::vector<Move> pv;
-    while (true) {
+    while (pv.size() < MAX_PLY) {
         TT_result tt_result = tt.get(board.get_z_key());
-        if (!tt_result.is_hit || tt_result.tt_entry.hash_move.get_node_type() != NODE_EXACT ||
-            board.has_repeated_once()) {
+        if (!tt_result.is_hit || board.has_repeated_once() ||
+            (!follow_bounds && tt_result.tt_entry.hash_move.get_node_type() != NODE_EXACT)) {
             break;
         }
         Move m = tt_result.tt_entry.hash_move.to_move();
         MoveList legal_moves;
         board.generate_moves(legal_moves);
-        assert(legal_moves.contains(tt_result.tt_entry.hash_move.to_move()));
+        if (!legal_moves.contains(m)) {
+            break;
+        }
         pv.push_back(m);
         board.make_move(m);
     }
@@ -157,6 +375,17 @@ std::vector<Move> Search::get_pv() {
     return pv;
 }
 
+std::vector<Move> Search::get_pv(Move first_move) {
+    // Root entry only holds the best line, so walk the TT from after first_move instead
+    std::vector<Move> pv;
+    pv.push_back(first_move);
+    board.make_move(first_move);
+    std::vector<Move> rest = get_pv();
+    board.unmake_move();
+    pv.insert(pv.end(), rest.begin(), rest.end());
+    return pv;
+}
+
 std::string print_move_vector(std::vector<Move> moves) {
     std::ostringstream s;
     for (auto it = moves.begin(); it != moves.end(); it++) {
@@ -168,6 +397,15 @@ std::string print_move_vector(std::vector<Move> moves) {
 }
 
 
+U64 Search::position_key(unsigned int ply_from_root) {
+    // Searches with an excluded move get their own TT slot so they can't overwrite the entry of the full node
+    Move excluded_move = excluded_moves[ply_from_root];
+    if (excluded_move.get_raw_data() == 0) {
+        return board.get_z_key();
+    }
+    return board.get_z_key() ^ ((excluded_move.get_raw_data() & 0xFFFF) * C64(0x9E3779B97F4A7C15));
+}
+
 void Search::store_pos_result(HashMove best_move, unsigned int depth, unsigned int node_type, int score,
                               unsigned int ply_from_root) {
     if (score >= MINMATE) {
@@ -175,7 +413,7 @@ void Search::store_pos_result(HashMove best_move, unsigned int depth, unsigned i
     } else if (score <= -MINMATE) {
         score -= ply_from_root; // -(MAXMATE - (distance from this position to mate)
     }
-    tt.set(board.get_z_key(), best_move, depth, node_type, score);
+    tt.set(position_key(ply_from_root), best_move, depth, node_type, score);
 }
 
 
@@ -194,8 +432,13 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
         return 0;
     }
 
+    Move excluded_move = excluded_moves[ply_from_root];
+    const bool is_excluded_search = excluded_move.get_raw_data() != 0;
+
     // Check for hits on the TT
-    const TT_result tt_result = tt.get(board.get_z_key());
+    const TT_result tt_result = tt.get(position_key(ply_from_root));
+    stats.tt_probes++;
+    stats.tt_hits += tt_result.is_hit;
 
     if (tt_result.is_hit && tt_result.tt_entry.hash_move.get_depth() >= depth) {
 
@@ -228,7 +471,7 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
             return negamax(1, alpha, beta, ply_from_root, ply_extended + 1, false);
         }
         return quiescence_search(0, alpha, beta, ply_from_root);
-    } else if (time_handler.should_stop()) {
+    } else if (should_stop()) {
         // Reset board to original state
         for (int i = ply_from_root; i != 0; i--) {
             if (board.get_move_stack().back().is_null_move) {
@@ -255,15 +498,118 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
         }
     }
 
+    // A singular search only looks at the alternatives to the excluded move
+    if (is_excluded_search) {
+        MoveList alternatives;
+        for (auto it = moves.begin(); it != moves.end(); ++it) {
+            if (*it != excluded_move) {
+                alternatives.push_back(*it);
+            }
+        }
+        if (alternatives.size() == 0) {
+            return alpha;
+        }
+        moves = alternatives;
+    }
+
+    // Position is improving if it evaluates better than two plies ago (unknown counts as improving)
+    const int static_eval = is_in_check ? NO_EVAL : board.static_eval();
+    eval_stack[ply_from_root] = static_eval;
+    const bool improving = !is_in_check && (ply_from_root < 2 || eval_stack[ply_from_root - 2] == NO_EVAL ||
+                                            static_eval > eval_stack[ply_from_root - 2]);
+
+    const bool is_pv = beta - alpha > 1;
+    const bool do_static_pruning = !is_pv && !is_in_check && !is_excluded_search && beta < MINMATE && alpha > -MINMATE;
+
+    // Reverse futility pruning: static eval is so far above beta that a quiet move won't drag it back down
+    if (USE_REVERSE_FUTILITY_PRUNING && do_static_pruning && depth <= RFP_MAX_DEPTH &&
+        static_eval - RFP_MARGIN * (int) (depth - improving) >= beta) {
+        stats.rfp_cutoffs++;
+        return beta;
+    }
+
+    // Razoring: static eval is so far below alpha that only captures could help, so let quiescence search decide
+    if (USE_RAZORING && do_static_pruning && depth <= RAZOR_MAX_DEPTH &&
+        static_eval + RAZOR_MARGIN * (int) depth <= alpha) {
+        int razor_eval = quiescence_search(0, alpha, alpha + 1, ply_from_root);
+        if (depth == 1 || razor_eval <= alpha) {
+            stats.razor_cutoffs++;
+            return razor_eval;
+        }
+    }
+
 
     // Null move pruning
-    if (USE_NULL_MOVE_PRUNING && do_null_move && !is_in_check && !board.possible_zugzwang()) {
-        if (depth > R) {
+    // Reduce more at higher depths and the further static eval is above beta
+    if (USE_NULL_MOVE_PRUNING && do_null_move && !nmp_verifying && !is_in_check && !is_excluded_search && static_eval >= beta &&
+        !board.possible_zugzwang()) {
+        if (depth > NMP_BASE_R) {
+            int reduction = NMP_BASE_R + depth / NMP_DEPTH_DIVISOR +
+                            std::min((static_eval - beta) / NMP_EVAL_DIVISOR, NMP_MAX_EVAL_R);
+            unsigned int null_depth = std::max((int) depth - 1 - reduction, 0);
+
+            stats.nmp_tries++;
+            line_moves[ply_from_root] = Move();
             board.make_null_move();
-            int null_eval = -negamax(depth - 1 - R, -beta, -beta + 1, ply_from_root + 1, ply_extended, false);
+            int null_eval = -negamax(null_depth, -beta, -beta + 1, ply_from_root + 1, ply_extended, false);
             board.unmake_null_move();
 
             if (null_eval >= beta) {
+                // At high depth, make sure this isn't zugzwang by searching the same depth without null moves
+                // Null moves stay off below it too, so no child can null move its way back to the same cutoff
+                bool verified = depth < NMP_VERIFY_DEPTH;
+                if (!verified) {
+                    nmp_verifying = true;
+                    try {
+                        verified = negamax(null_depth, beta - 1, beta, ply_from_root, ply_extended, false) >= beta;
+                    } catch (SearchTimeout& e) {
+                        nmp_verifying = false;
+                        throw;
+                    }
+                    nmp_verifying = false;
+                }
+                if (verified) {
+                    stats.nmp_cutoffs++;
+                    return beta;
+                }
+                stats.nmp_verify_failures++;
+            }
+        }
+    }
+
+    // ProbCut
+    // Skip it if the TT already has a deep enough result saying the raised bound won't be reached
+    const int probcut_beta = beta + PROBCUT_MARGIN;
+    if (USE_PROBCUT && do_static_pruning && depth >= PROBCUT_MIN_DEPTH && probcut_beta < MINMATE &&
+        !(tt_result.is_hit && tt_result.tt_entry.hash_move.get_depth() + PROBCUT_REDUCTION >= depth &&
+          tt_result.tt_entry.score < probcut_beta)) {
+        MoveList captures;
+        board.generate_moves<CAPTURES_ONLY>(captures);
+        unsigned int probcut_depth = depth - PROBCUT_REDUCTION;
+
+        for (auto it = captures.begin(); it != captures.end(); ++it) {
+            // Only captures that win enough material by themselves are worth a try
+            if (board.static_exchange_eval(*it) < probcut_beta - static_eval) {
+                continue;
+            }
+
+            stats.probcut_tries++;
+            nodes_searched++;
+            line_moves[ply_from_root] = *it;
+            board.make_move(*it);
+            // Cheap quiescence check first, then confirm with the reduced search
+            int probcut_eval = -quiescence_search(0, -probcut_beta, -probcut_beta + 1, ply_from_root + 1);
+            if (probcut_eval >= probcut_beta) {
+                probcut_eval = -negamax(probcut_depth - 1, -probcut_beta, -probcut_beta + 1, ply_from_root + 1,
+                                        ply_extended, true);
+            }
+            board.unmake_move();
+
+            if (probcut_eval >= probcut_beta) {
+                HashMove probcut_move;
+                probcut_move = *it;
+                store_pos_result(probcut_move, probcut_depth, NODE_LOWERBOUND, probcut_beta, ply_from_root);
+                stats.probcut_cutoffs++;
                 return beta;
             }
         }
@@ -274,7 +620,49 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
         move_to_assign = tt_result.tt_entry.hash_move;
         assert(move_to_assign.get_raw_data() != 0);
     }
-    assign_move_scores<true>(moves, move_to_assign, &killer_moves[ply_from_root][0]);
+
+    // Move ordering is at its worst without a TT move, and these are the most expensive nodes to get wrong
+    if ((move_to_assign.get_raw_data() & 0x3FFFFF) == 0 && depth >= IID_MIN_DEPTH) {
+        if (USE_INTERNAL_ITERATIVE_DEEPENING) {
+            stats.iid_searches++;
+            negamax(depth - IID_REDUCTION, alpha, beta, ply_from_root, ply_extended, false);
+            const TT_result iid_result = tt.get(position_key(ply_from_root));
+            if (iid_result.is_hit) {
+                move_to_assign = iid_result.tt_entry.hash_move;
+            }
+        } else if (USE_INTERNAL_ITERATIVE_REDUCTION) {
+            stats.iir_reductions++;
+            depth--;
+        }
+    }
+
+    // Singular extensions
+    // If a deep enough lower bound says the TT move is good, check whether any alternative comes close
+    unsigned int singular_extension = 0;
+    const int tt_score = tt_result.tt_entry.score;
+    if (USE_SINGULAR_EXTENSIONS && !is_excluded_search && depth >= SE_MIN_DEPTH && ply_extended < EXTENSION_LIMIT &&
+        tt_result.is_hit && (move_to_assign.get_raw_data() & 0x3FFFFF) != 0 &&
+        move_to_assign.get_node_type() != NODE_UPPERBOUND &&
+        move_to_assign.get_depth() + SE_TT_DEPTH_MARGIN >= depth &&
+        tt_score < MINMATE && tt_score > -MINMATE) {
+
+        int singular_beta = tt_score - SE_MARGIN * (int) depth;
+        stats.se_tries++;
+        excluded_moves[ply_from_root] = move_to_assign.to_move();
+        int singular_eval = negamax(depth / 2, singular_beta - 1, singular_beta, ply_from_root, ply_extended, false);
+        excluded_moves[ply_from_root] = Move();
+
+        if (singular_eval < singular_beta) {
+            singular_extension = 1;
+            stats.se_extensions++;
+        } else if (singular_beta >= beta) {
+            // Multi-cut: the TT move and at least one alternative both beat beta
+            stats.multicut_cutoffs++;
+            return beta;
+        }
+    }
+
+    assign_move_scores<true>(moves, move_to_assign, &killer_moves[ply_from_root][0], ply_from_root);
 
     bool do_pvs = depth > 2;
 
@@ -285,17 +673,32 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
     unsigned int node_type = NODE_UPPERBOUND;
 
     // For tactical stability, do not reduce moves when in check
-    const bool do_lmr = !is_in_check && depth > 2 && beta-alpha <= 1;
-    unsigned int* lmr_value_ptr = lmr_values;
+    const bool do_lmr = !is_in_check && depth > 2;
+    const bool do_quiet_pruning = !is_pv && !is_in_check;
+    const bool is_futile = USE_FUTILITY_PRUNING && do_static_pruning && depth <= FUTILITY_MAX_DEPTH &&
+                           static_eval + FUTILITY_BASE + FUTILITY_MARGIN * (int) depth <= alpha;
+    unsigned int move_count = 0;
+
+    // Quiets and captures that were searched without causing a cutoff, penalized if a later move does
+    Move quiets_searched[256];
+    unsigned int quiet_count = 0;
+    Move captures_searched[256];
+    unsigned int capture_count = 0;
+    const bool do_see_pruning = USE_SEE_PRUNING && !is_pv && !is_in_check && depth <= SEE_PRUNE_MAX_DEPTH;
+    const bool use_abdada = parallel_mode == abdada && num_threads > 1 && depth >= ABDADA_MIN_DEPTH;
 
     if (USE_PV_SEARCH && do_pvs) {
         int first_eval;
         auto first_move = ++move_picker;
         nodes_searched++;
-        lmr_value_ptr++;
+        move_count++;
+
+        // Only the TT move can be singular
+        unsigned int extension = move_to_assign == first_move ? singular_extension : 0;
 
+        line_moves[ply_from_root] = first_move;
         board.make_move(first_move);
-        first_eval = -negamax(depth - 1, -beta, -alpha, ply_from_root + 1, ply_extended, true);
+        first_eval = -negamax(depth - 1 + extension, -beta, -alpha, ply_from_root + 1, ply_extended + extension, true);
         board.unmake_move();
 
         if (first_eval >= beta) {
@@ -303,9 +706,21 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
             assert(best_move.get_raw_data() != 0);
             store_pos_result(best_move, depth, NODE_LOWERBOUND, beta, ply_from_root);
             register_killers(ply_from_root, first_move);
-            register_history_move(depth, first_move);
+            if (first_move.is_capture()) {
+                update_capture_history(depth, first_move, true);
+            } else if (first_move.get_special_flag() == MOVE_NORMAL) {
+                register_history_move(depth, first_move, ply_from_root);
+                register_counter_move(ply_from_root, first_move);
+            }
+            stats.beta_cutoffs++;
+            stats.first_move_cutoffs++;
             return beta;
         }
+        if (first_move.is_capture()) {
+            captures_searched[capture_count++] = first_move;
+        } else if (first_move.get_special_flag() == MOVE_NORMAL) {
+            quiets_searched[quiet_count++] = first_move;
+        }
         if (first_eval > alpha) {
             node_type = NODE_EXACT;
             best_move = first_move;
@@ -317,16 +732,63 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
         int eval;
         unsigned int effective_depth = depth;
         auto it = ++move_picker;
-        unsigned int depth_reduction_value = *lmr_value_ptr;
-        lmr_value_ptr++;
+        const bool is_quiet = !it.is_capture() && it.get_special_flag() == MOVE_NORMAL;
+
+        // Skip late and historically bad quiets, as long as something has already kept us out of a mate score
+        if (do_quiet_pruning && is_quiet && move_count > 0 && alpha > -MINMATE &&
+            killer_moves[ply_from_root][0] != it && killer_moves[ply_from_root][1] != it &&
+            is_quiet_prunable(depth, move_count, it, improving, ply_from_root)) {
+            continue;
+        }
+
+        // Skip captures that lose too much material to be worth searching at low depth
+        if (do_see_pruning && it.is_capture() && move_count > 0 && alpha > -MINMATE && Board::mvv_lva(it) < 0 &&
+            board.static_exchange_eval(it) < -SEE_PRUNE_MARGIN * (int) depth) {
+            stats.see_pruned++;
+            continue;
+        }
+
+        // ABDADA: leave moves another thread is already searching until last, by which time they may be in the TT
+        U64 move_key = 0;
+        if (use_abdada) {
+            move_key = position_key(ply_from_root) ^ ((it.get_raw_data() & 0xFFFF) * C64(0xD6E8FEB86659FD93));
+            if (move_count > 0 && !move_picker.is_revisit() && tt.is_being_searched(move_key)) {
+                move_picker.defer(it);
+                continue;
+            }
+        }
 
         nodes_searched++;
 
+        line_moves[ply_from_root] = it;
         board.make_move(it);
 
-        effective_depth = determine_depth(effective_depth, depth_reduction_value, it, do_lmr);
+        // Futility pruning: a quiet can't make up the gap to alpha unless it gives check
+        if (is_futile && is_quiet && move_count > 0 && !board.is_in_check()) {
+            board.unmake_move();
+            stats.futility_pruned++;
+            continue;
+        }
 
-        pvs_lmr_core(alpha, beta, ply_from_root, ply_extended, do_pvs, eval, effective_depth, depth);
+        unsigned int extension = move_to_assign == it ? singular_extension : 0;
+        effective_depth = determine_depth(effective_depth, move_count, it, do_lmr, is_pv, improving, ply_from_root);
+        move_count++;
+
+        if (use_abdada) {
+            // A timeout must not leave the move marked, or other threads would keep deferring it in later searches
+            tt.mark_searching(move_key);
+            try {
+                pvs_lmr_core(alpha, beta, ply_from_root, ply_extended + extension, do_pvs, eval,
+                             effective_depth + extension, depth + extension);
+            } catch (SearchTimeout& e) {
+                tt.unmark_searching(move_key);
+                throw;
+            }
+            tt.unmark_searching(move_key);
+        } else {
+            pvs_lmr_core(alpha, beta, ply_from_root, ply_extended + extension, do_pvs, eval,
+                         effective_depth + extension, depth + extension);
+        }
 
         board.unmake_move();
 
@@ -335,9 +797,27 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
             assert(best_move.get_raw_data() != 0);
             store_pos_result(best_move, depth, NODE_LOWERBOUND, beta, ply_from_root);
             register_killers(ply_from_root, it);
-            register_history_move(depth, it);
+            if (it.is_capture()) {
+                update_capture_history(depth, it, true);
+            } else if (is_quiet) {
+                register_history_move(depth, it, ply_from_root);
+                register_counter_move(ply_from_root, it);
+            }
+            for (unsigned int i = 0; i < quiet_count; i++) {
+                penalize_history_move(depth, quiets_searched[i], ply_from_root);
+            }
+            for (unsigned int i = 0; i < capture_count; i++) {
+                update_capture_history(depth, captures_searched[i], false);
+            }
+            stats.beta_cutoffs++;
+            stats.first_move_cutoffs += move_count == 1;
             return beta;
         }
+        if (it.is_capture()) {
+            captures_searched[capture_count++] = it;
+        } else if (is_quiet) {
+            quiets_searched[quiet_count++] = it;
+        }
         if (eval > alpha) {
             node_type = NODE_EXACT;
             best_move = it;
@@ -346,6 +826,12 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
     }
 
 
+    // Fail-low nodes have no best move of their own; MTD(f) keeps the one already stored, usually the refutation
+    // found by an earlier probe, so that the PV can still be followed through nodes every probe fails low in
+    if (root_driver == mtdf && node_type == NODE_UPPERBOUND && (move_to_assign.get_raw_data() & 0x3FFFFF) != 0) {
+        best_move = move_to_assign.to_move();
+    }
+
     // Write search data to transposition table
     assert(best_move.get_raw_data() != 0 || node_type == NODE_UPPERBOUND);
     store_pos_result(best_move, depth, node_type, alpha, ply_from_root);
@@ -353,14 +839,34 @@ int Search::negamax(unsigned int depth, int alpha, int beta, unsigned int ply_fr
     return alpha;
 }
 
-unsigned int Search::determine_depth(unsigned int effective_depth, unsigned int depth_reduction_value, Move move, bool do_lmr) {
+unsigned int Search::determine_depth(unsigned int depth, unsigned int move_count, Move move, bool do_lmr, bool is_pv,
+                                     bool improving, unsigned int ply_from_root) {
     // Don't do lmr if move is tactical (capture, promotion)
     // Don't reduce when move gives check
-    if (USE_LATE_MOVE_REDUCTION && do_lmr && !move.is_capture() && move.get_special_flag() == MOVE_NORMAL &&
-        !board.is_in_check()) {
-        effective_depth = std::max((effective_depth - depth_reduction_value) * (effective_depth >= depth_reduction_value), 1U);
+    if (!USE_LATE_MOVE_REDUCTION || !do_lmr || move.is_capture() || move.get_special_flag() != MOVE_NORMAL ||
+        board.is_in_check()) {
+        return depth;
     }
-    return effective_depth;
+
+    int reduction = lmr_table[std::min(depth, (unsigned int) MAX_DEPTH)][std::min(move_count, 255U)];
+
+    // The adjustments below only tune a reduction the table already gives, so early moves are never reduced
+    if (move_count < LMR_MIN_MOVES || reduction == 0) {
+        return depth;
+    }
+
+    // PV nodes matter more, and a worsening position is less likely to need a late move
+    reduction -= is_pv;
+    reduction += !improving;
+
+    // Quiets that have often caused cutoffs are reduced less, and those that often failed more
+    // (move has been made, so the mover is the other side)
+    reduction -= quiet_history(!board.get_current_turn(), move, ply_from_root) / LMR_HISTORY_DIVISOR;
+
+    // Always leave at least one ply to search
+    reduction = std::max(0, std::min(reduction, (int) depth - 1));
+    stats.lmr_reductions += reduction > 0;
+    return depth - reduction;
 }
 
 void
@@ -370,6 +876,11 @@ Search::pvs_lmr_core(int alpha, int beta, unsigned int ply_from_root, unsigned i
     if (USE_PV_SEARCH && do_pvs) {
         // null window search with reduced depth
         eval = -negamax(effective_depth - 1, -alpha - 1, -alpha, ply_from_root + 1, ply_extended, true);
+        // A reduced move that beats alpha must be verified at full depth before it is trusted
+        if (eval > alpha && effective_depth != depth) {
+            stats.lmr_researches++;
+            eval = -negamax(depth - 1, -alpha - 1, -alpha, ply_from_root + 1, ply_extended, true);
+        }
         // Check if within bounds
         if (eval > alpha && eval < beta) {
             // If so, research with full window with normal depth
@@ -382,6 +893,7 @@ Search::pvs_lmr_core(int alpha, int beta, unsigned int ply_from_root, unsigned i
         eval = -negamax(effective_depth - 1, -beta, -alpha, ply_from_root + 1, ply_extended, true);
         // Nodes that raise alpha must be re-searched if depth was reduced
         if (eval > alpha && eval < beta && effective_depth != depth) {
+            stats.lmr_researches++;
             // Research with full window with normal depth
             eval = -negamax(depth - 1, -beta, -alpha, ply_from_root + 1, ply_extended, true);
         }
@@ -396,11 +908,107 @@ void Search::register_killers(unsigned int ply_from_root, Move move) {
     }
 }
 
-void Search::register_history_move(unsigned int depth, Move move) {
+static inline unsigned int piece_to_index(Move move) {
+    return (move.get_piece_moved() - PIECE_KING) * 64 + move.get_to();
+}
+
+int* Search::continuation_entry(unsigned int plies_back, unsigned int side, Move move, unsigned int ply_from_root) {
+    // Null if there is no move that many plies back on this line (before the root, or a null move)
+    if (!USE_CONTINUATION_HISTORY || ply_from_root < plies_back) {
+        return nullptr;
+    }
+    Move previous = line_moves[ply_from_root - plies_back];
+    if (previous.get_raw_data() == 0) {
+        return nullptr;
+    }
+    return &continuation_history[plies_back - 1][(side * 384 + piece_to_index(previous)) * 384 + piece_to_index(move)];
+}
+
+int Search::quiet_history(unsigned int side, Move move, unsigned int ply_from_root) {
+    int score = history_moves[side][move.get_from()][move.get_to()];
+    for (unsigned int plies_back = 1; plies_back <= 2; plies_back++) {
+        int* entry = continuation_entry(plies_back, side, move, ply_from_root);
+        if (entry) {
+            score += *entry;
+        }
+    }
+    return score;
+}
+
+static inline void apply_history_gravity(int& entry, int bonus) {
+    // Moves the entry toward +-HISTORY_MAX, more slowly the closer it already is
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
+
+void Search::update_quiet_history(int bonus, Move move, unsigned int ply_from_root) {
+    // Called before the move is made
+    unsigned int side = board.get_current_turn();
+    apply_history_gravity(history_moves[side][move.get_from()][move.get_to()], bonus);
+    for (unsigned int plies_back = 1; plies_back <= 2; plies_back++) {
+        int* entry = continuation_entry(plies_back, side, move, ply_from_root);
+        if (entry) {
+            apply_history_gravity(*entry, bonus);
+        }
+    }
+}
+
+void Search::register_history_move(unsigned int depth, Move move, unsigned int ply_from_root) {
     assert(move.get_raw_data());
     if (USE_HIST_HEURISTIC) {
-        history_moves[board.get_current_turn()][move.get_from()][move.get_to()] += depth * depth;
+        update_quiet_history(std::min(HISTORY_BONUS_SCALE * (int) (depth * depth), HISTORY_BONUS_MAX), move,
+                             ply_from_root);
+    }
+}
+
+void Search::penalize_history_move(unsigned int depth, Move move, unsigned int ply_from_root) {
+    assert(move.get_raw_data());
+    if (USE_HIST_HEURISTIC) {
+        update_quiet_history(-std::min(HISTORY_BONUS_SCALE * (int) (depth * depth), HISTORY_BONUS_MAX), move,
+                             ply_from_root);
+    }
+}
+
+int& Search::capture_history_entry(Move move) {
+    return capture_history[board.get_current_turn()][move.get_piece_moved()][move.get_to()][move.get_piece_captured()];
+}
+
+void Search::update_capture_history(unsigned int depth, Move move, bool is_cutoff) {
+    // Called before the move is made
+    assert(move.is_capture());
+    if (USE_HIST_HEURISTIC) {
+        int bonus = std::min(HISTORY_BONUS_SCALE * (int) (depth * depth), HISTORY_BONUS_MAX);
+        apply_history_gravity(capture_history_entry(move), is_cutoff ? bonus : -bonus);
+    }
+}
+
+void Search::register_counter_move(unsigned int ply_from_root, Move move) {
+    if (USE_COUNTER_MOVES && ply_from_root > 0 && line_moves[ply_from_root - 1].get_raw_data() != 0) {
+        Move previous = line_moves[ply_from_root - 1];
+        counter_moves[board.get_current_turn()][previous.get_piece_moved()][previous.get_to()] = move;
+    }
+}
+
+Move Search::get_counter_move(unsigned int ply_from_root) {
+    if (!USE_COUNTER_MOVES || ply_from_root == 0 || line_moves[ply_from_root - 1].get_raw_data() == 0) {
+        return Move();
     }
+    Move previous = line_moves[ply_from_root - 1];
+    return counter_moves[board.get_current_turn()][previous.get_piece_moved()][previous.get_to()];
+}
+
+bool Search::is_quiet_prunable(unsigned int depth, unsigned int move_count, Move move, bool improving,
+                               unsigned int ply_from_root) {
+    // Called before the move is made, for quiet moves in non-PV nodes that aren't in check
+    if (USE_LATE_MOVE_PRUNING && depth <= LMP_MAX_DEPTH && move_count >= (LMP_BASE + depth * depth) / (2 - improving)) {
+        stats.lmp_pruned++;
+        return true;
+    }
+    if (USE_HISTORY_PRUNING && depth <= HISTORY_PRUNE_MAX_DEPTH &&
+        quiet_history(board.get_current_turn(), move, ply_from_root) < -HISTORY_PRUNE_MARGIN * (int) depth) {
+        stats.history_pruned++;
+        return true;
+    }
+    return false;
 }
 
 
@@ -456,21 +1064,36 @@ int Search::quiescence_search(unsigned int ply_from_horizon, int alpha, int beta
     return alpha;
 }
 
-void Search::log_search_info(int depth, int eval, bool book_move) {
+void Search::log_search_info(int depth, int eval, Move pv_move, unsigned int pv_index, bool book_move) {
+    if (silent) {
+        return;
+    }
     std::ostringstream buffer;
     buffer << "info ";
-    buffer << "score cp " << eval;
+    if (multi_pv > 1) {
+        buffer << "multipv " << pv_index << ' ';
+    }
+    if (eval >= MINMATE) {
+        buffer << "score mate " << (MAXMATE - eval + 1) / 2;
+    } else if (eval <= -MINMATE) {
+        buffer << "score mate " << -((MAXMATE + eval) / 2);
+    } else {
+        buffer << "score cp " << eval;
+    }
     buffer << " depth " << depth;
-    buffer << " nodes " << nodes_searched;
-    if (!book_move) {
-        buffer << " pv " << print_move_vector(get_pv());
+    buffer << " nodes " << get_total_nodes();
+    if (!book_move && pv_move.get_raw_data() != 0) {
+        buffer << " pv " << print_move_vector(get_pv(pv_move));
     }
     buffer << '\n';
     get_synced_cout().print(buffer.str());
 }
 
 void Search::search_finished_message(Move best_move, int depth, int eval, bool book_move) {
-    log_search_info(depth, eval, book_move);
+    if (silent) {
+        return;
+    }
+    log_search_info(depth, eval, best_move, 1, book_move);
     std::ostringstream buffer;
     buffer << "bestmove " << move_to_str(best_move, true);
     buffer << '\n';
@@ -478,340 +1101,636 @@ void Search::search_finished_message(Move best_move, int depth, int eval, bool b
 }
 
 
-Move Search::find_best_move(unsigned int max_depth = MAX_DEPTH) {
-    max_depth = std::min(max_depth, (unsigned int) MAX_DEPTH);
-    board.hash();
-    tt.increment_age();
-    type2collision = 0;
-    nodes_searched = 0;
+bool Search::search_root(unsigned int depth, MoveList& moves, bool is_in_check, Move& best_move, int& eval) {
+    // Searches the given root moves with an aspiration window centered on eval
+    // On success best_move and eval hold the result; on timeout best_move holds the move that is safest to play
+    HashMove best_move_temp;
+    best_move_temp = best_move;
 
-    // Clear killers
-    for (int i = 0; i < MAX_DEPTH; i++) {
-        killer_moves[i][0] = Move();
-        killer_moves[i][1] = Move();
-    }
-    // Clear history table
-    for (int turn = 0; turn < 2; turn++) {
-        for (int y = 0; y < 64; y++) {
-            for (int x = 0; x < 64; x++) {
-                history_moves[turn][y][x] = 0;
-            }
-        }
-    }
-
-    time_handler.start();
-
-    // Check opening_book
-    if (USE_BOOK && opening_book.can_use_book() && board.get_reg_starting_pos()) {
-        Move book_move = opening_book.request(board.get_move_stack());
-        if (!book_move.is_illegal()) {
-            time_handler.stop();
-            search_finished_message(book_move, 0, 0, true);
-            return book_move;
-        }
-    }
-
-    Move best_move; // Best verified move
-    int max_eval; // Best verified score
-
-    bool is_in_check;
-    MoveList moves;
-    board.generate_moves(moves, is_in_check);
-
-    // Don't bother searching if there's one legal move
-    if (moves.size() == 1) {
-        search_finished_message(moves[0], 0, 0);
-        return moves[0];
-    }
-
-    int expected_eval = 0;
-
-    // Iterative deepening loop
-    int depth;
-    for (depth = 1; depth <= max_depth; depth++) {
-
-        HashMove best_move_temp;
-        best_move_temp = best_move;
-
-        bool do_pvs = depth > 2;
+    bool do_pvs = depth > 2;
 
+    int expected_eval = eval;
+    int upper_bound = 25;
+    int lower_bound = 25;
 
-        int upper_bound = 25;
-        int lower_bound = 25;
 
+    unsigned int times_researched = 0;
 
-        unsigned int times_researched = 0;
+    root_later_moves = 0;
+    root_later_fail_highs = 0;
 
-        // Aspiration window re-search loop
-        while (true) {
-            times_researched++;
+    // Aspiration window re-search loop
+    while (true) {
+        times_researched++;
 
 //            std::cout << "Windows: ("  << alpha << ", " << (expected_eval + upper_bound) << ")\n";
 
-            int alpha; // Best score for this search
-            int beta;
-            Move local_best_move; // Best move for this search
+        int alpha; // Best score for this search
+        int beta;
+        Move local_best_move; // Best move for this search
+        unsigned int move_index = 0;
+        unsigned int local_best_index = 0;
 
-            if (!USE_ASPIRATION_WINDOWS) {
-                upper_bound = MAXMATE + 1; // If not using aspiration windows, set it to -inf
-                lower_bound = MAXMATE + 1; // Same for beta, this time +inf
-                expected_eval = 0;
-            }
-
-            alpha = expected_eval - lower_bound;
-            beta = expected_eval + upper_bound;
+        if (!USE_ASPIRATION_WINDOWS) {
+            upper_bound = MAXMATE + 1; // If not using aspiration windows, set it to -inf
+            lower_bound = MAXMATE + 1; // Same for beta, this time +inf
+            expected_eval = 0;
+        }
 
-            assign_move_scores<true>(moves, best_move_temp, &killer_moves[0][0]);
-            MovePicker move_picker(moves);
+        alpha = expected_eval - lower_bound;
+        beta = expected_eval + upper_bound;
 
+        if (root_node_counts.empty()) {
+            assign_move_scores<true>(moves, best_move_temp, &killer_moves[0][0], 0);
+        } else {
+            order_root_moves(moves, best_move_temp);
+        }
+        MovePicker move_picker(moves);
 
-            unsigned int* lmr_value_ptr = lmr_values;
-            const bool do_lmr = !is_in_check && depth > 2 && beta-alpha <= 1;
 
-            if (USE_PV_SEARCH && do_pvs) {
-                int first_eval;
-                auto first_move = ++move_picker;
-                nodes_searched++;
-                lmr_value_ptr++;
+        const bool do_lmr = !is_in_check && depth > 2 && beta-alpha <= 1;
 
-                board.make_move(first_move);
-                try {
-                    first_eval = -negamax(depth - 1, -beta, -alpha, 1, 0, true);
-                } catch (SearchTimeout& e) {
-                    search_finished_message(best_move, depth - 1, max_eval);
-                    time_handler.stop();
-                    return best_move;
-                }
-                board.unmake_move();
+        if (USE_PV_SEARCH && do_pvs) {
+            int first_eval;
+            auto first_move = ++move_picker;
+            U64 nodes_before = nodes_searched;
+            nodes_searched++;
+            move_index++;
 
-                if (first_eval >= beta) {
-                    // This will cause the rest of the moves to be skipped
-                    assert(USE_ASPIRATION_WINDOWS); // beta cutoff should only occur in aspirated search
-                    alpha = first_eval;
-                    while (!move_picker.finished()) {
-                        ++move_picker;
-                    }
-                    register_killers(0, first_move);
-                    register_history_move(depth, first_move);
+            line_moves[0] = first_move;
+            board.make_move(first_move);
+            try {
+                first_eval = -negamax(depth - 1, -beta, -alpha, 1, 0, true);
+            } catch (SearchTimeout& e) {
+                return false;
+            }
+            board.unmake_move();
+            record_root_nodes(first_move, nodes_searched - nodes_before);
+
+            if (first_eval >= beta) {
+                // This will cause the rest of the moves to be skipped
+                assert(USE_ASPIRATION_WINDOWS); // beta cutoff should only occur in aspirated search
+                alpha = first_eval;
+                while (!move_picker.finished()) {
+                    ++move_picker;
                 }
-                if (first_eval > alpha) {
-                    local_best_move = first_move;
-                    alpha = first_eval;
+                register_killers(0, first_move);
+                if (!first_move.is_capture() && first_move.get_special_flag() == MOVE_NORMAL) {
+                    register_history_move(depth, first_move, 0);
                 }
             }
+            if (first_eval > alpha) {
+                local_best_move = first_move;
+                alpha = first_eval;
+            }
+        }
 
+        // YBWC: with the eldest brother searched, the remaining root moves are split between the threads
+        if (root_split && do_pvs && !move_picker.finished()) {
+            RootSplit& split = *root_split;
+            std::unique_lock<std::mutex> lock(split.lock);
+            split.moves = MoveList();
             while (!move_picker.finished()) {
-                int eval;
-                unsigned int effective_depth = depth;
-                auto it = ++move_picker;
-                unsigned int depth_reduction_value = *lmr_value_ptr;
-                lmr_value_ptr++;
-
-                nodes_searched++;
-                board.make_move(it);
-
-                effective_depth = determine_depth(effective_depth, depth_reduction_value, it, do_lmr);
-
-                try {
-                    pvs_lmr_core(alpha, beta, 0, 0, do_pvs, eval, effective_depth, depth);
-                } catch (SearchTimeout& e) {
-                    Move m;
-                    // Check if alpha is currently in aspiration window
-                    // If it is, take the current best move; else take the last confirmed best move
-                    if (alpha <= expected_eval - lower_bound || alpha >= expected_eval + upper_bound) {
-                        m = best_move;
-                    } else {
-                        m = local_best_move;
-                    }
-                    search_finished_message(m, depth - 1, max_eval);
-                    time_handler.stop();
-                    return m;
-                }
-                board.unmake_move();
-
-                if (eval >= beta) {
-                    // In case of fail-high break loop early
-                    assert(USE_ASPIRATION_WINDOWS); // beta cutoff should only occur in aspirated search
-                    alpha = eval;
-                    register_killers(0, it);
-                    register_history_move(depth, it);
-                    break;
+                split.moves.push_back(++move_picker);
+            }
+            split.move_nodes.assign(split.moves.size(), 0);
+            split.next = 0;
+            split.depth = depth;
+            split.alpha = alpha;
+            split.beta = beta;
+            split.do_lmr = do_lmr;
+            split.do_pvs = do_pvs;
+            split.stop_work = alpha >= beta;
+            split.timed_out = false;
+            split.failed_high = false;
+            split.best_move = Move();
+            split.generation++;
+            split.active++;
+            split.cv.notify_all();
+            lock.unlock();
+
+            ybw_root_work(split);
+
+            lock.lock();
+            split.active--;
+            split.cv.wait(lock, [&split] { return split.active == 0; });
+
+            for (int i = 0; i < split.moves.size(); i++) {
+                record_root_nodes(split.moves[i], split.move_nodes[i]);
+            }
+            if (split.timed_out) {
+                if (split.alpha > alpha && split.alpha < beta) {
+                    best_move = split.best_move;
+                } else if (!(alpha <= expected_eval - lower_bound || alpha >= expected_eval + upper_bound)) {
+                    best_move = local_best_move;
                 }
-                if (eval > alpha) {
-                    alpha = eval;
-                    local_best_move = it;
+                return false;
+            }
+            if (split.alpha > alpha) {
+                alpha = split.alpha;
+                local_best_move = split.best_move;
+                local_best_index = split.best_index + 1;
+            }
+            if (split.failed_high) {
+                register_killers(0, split.best_move);
+                if (!split.best_move.is_capture() && split.best_move.get_special_flag() == MOVE_NORMAL) {
+                    register_history_move(depth, split.best_move, 0);
                 }
-            } // Move picker loop
-
-            // Check if score is within bounds
-            if (alpha >= expected_eval + upper_bound) {
-                // If so, do a re-search
-                assert(USE_ASPIRATION_WINDOWS); // Should not fail when not using asp_windows
-                if (times_researched >= 4) {
-                    // If we've searched too many times and there's still no viable result, give up and widen bounds all the way
-                    expected_eval = 0;
-                    upper_bound = MAXMATE + 1;
-                    lower_bound = MAXMATE + 1;
-                } else {
-                    upper_bound *= 4;
+            }
+        }
+
+        while (!move_picker.finished()) {
+            int move_eval;
+            unsigned int effective_depth = depth;
+            auto it = ++move_picker;
+
+            U64 nodes_before = nodes_searched;
+            nodes_searched++;
+            line_moves[0] = it;
+            board.make_move(it);
+
+            effective_depth = determine_depth(effective_depth, move_index, it, do_lmr, true, true, 0);
+
+            try {
+                pvs_lmr_core(alpha, beta, 0, 0, do_pvs, move_eval, effective_depth, depth);
+            } catch (SearchTimeout& e) {
+                // Check if alpha is currently in aspiration window
+                // If it is, take the current best move; else take the last confirmed best move
+                if (!(alpha <= expected_eval - lower_bound || alpha >= expected_eval + upper_bound)) {
+                    best_move = local_best_move;
                 }
-            } else if (alpha <= expected_eval - lower_bound) {
-                assert(USE_ASPIRATION_WINDOWS); // Should not fail when not using asp_windows
-                if (times_researched >= 4) {
-                    expected_eval = 0;
-                    upper_bound = MAXMATE + 1;
-                    lower_bound = MAXMATE + 1;
-                } else {
-                    lower_bound *= 4;
+                return false;
+            }
+            board.unmake_move();
+            record_root_nodes(it, nodes_searched - nodes_before);
+
+            // Moves after the first that still beat alpha mean the root was misordered
+            if (move_index > 0) {
+                root_later_moves++;
+                root_later_fail_highs += move_eval > alpha;
+            }
+            move_index++;
+
+            if (move_eval >= beta) {
+                // In case of fail-high break loop early
+                assert(USE_ASPIRATION_WINDOWS); // beta cutoff should only occur in aspirated search
+                alpha = move_eval;
+                register_killers(0, it);
+                if (!it.is_capture() && it.get_special_flag() == MOVE_NORMAL) {
+                    register_history_move(depth, it, 0);
                 }
-            } else {
-                // Search didn't fail high or fail low, so continue on to next stage of iterative deepening
-                expected_eval = alpha;
-                max_eval = alpha;
-                best_move = local_best_move;
                 break;
             }
+            if (move_eval > alpha) {
+                alpha = move_eval;
+                local_best_move = it;
+                local_best_index = move_index - 1;
+            }
+        } // Move picker loop
+
+        // Check if score is within bounds
+        if (alpha >= expected_eval + upper_bound) {
+            // If so, do a re-search
+            assert(USE_ASPIRATION_WINDOWS); // Should not fail when not using asp_windows
+            if (times_researched >= 4) {
+                // If we've searched too many times and there's still no viable result, give up and widen bounds all the way
+                expected_eval = 0;
+                upper_bound = MAXMATE + 1;
+                lower_bound = MAXMATE + 1;
+            } else {
+                upper_bound *= 4;
+            }
+        } else if (alpha <= expected_eval - lower_bound) {
+            assert(USE_ASPIRATION_WINDOWS); // Should not fail when not using asp_windows
+            if (times_researched >= 4) {
+                expected_eval = 0;
+                upper_bound = MAXMATE + 1;
+                lower_bound = MAXMATE + 1;
+            } else {
+                lower_bound *= 4;
+            }
+        } else {
+            // Search didn't fail high or fail low, so continue on to next stage of iterative deepening
+            eval = alpha;
+            best_move = local_best_move;
+            root_best_index = local_best_index;
+            return true;
         }
+    }
+}
 
-        // In the case of finding checkmate, end search early
+bool Search::mtdf_probe(unsigned int depth, MoveList& moves, bool is_in_check, int beta, Move& best_move, int& score) {
+    // Null window search of the root moves around beta
+    // score becomes beta with best_move set to the refuting move if the root fails high, beta - 1 otherwise
+    HashMove best_move_temp;
+    best_move_temp = best_move;
+    const int alpha = beta - 1;
+    const bool do_lmr = !is_in_check && depth > 2;
+    unsigned int move_index = 0;
+
+    if (root_node_counts.empty()) {
+        assign_move_scores<true>(moves, best_move_temp, &killer_moves[0][0], 0);
+    } else {
+        order_root_moves(moves, best_move_temp);
+    }
+    MovePicker move_picker(moves);
 
-        HashMove h_best_move;
-        h_best_move = best_move;
-        store_pos_result(h_best_move, depth, NODE_EXACT, max_eval, 0);
+    while (!move_picker.finished()) {
+        int move_eval;
+        auto it = ++move_picker;
 
-        // If we've found the shortest possible checkmate, exit early
-        if (max_eval >= MINMATE && MAXMATE - max_eval <= depth) {
-            search_finished_message(best_move, depth, max_eval);
-            time_handler.stop();
-            return best_move;
+        U64 nodes_before = nodes_searched;
+        nodes_searched++;
+        line_moves[0] = it;
+        board.make_move(it);
+
+        unsigned int effective_depth = determine_depth(depth, move_index, it, do_lmr, true, true, 0);
+
+        try {
+            // Always the PVS path, whose reduced null window search is verified at full depth
+            pvs_lmr_core(alpha, beta, 0, 0, true, move_eval, effective_depth, depth);
+        } catch (SearchTimeout& e) {
+            return false;
         }
+        board.unmake_move();
+        record_root_nodes(it, nodes_searched - nodes_before);
 
-        // Send this iteration's info to the gui
-        log_search_info(depth, max_eval);
+        if (move_index > 0) {
+            root_later_moves++;
+            root_later_fail_highs += move_eval > alpha;
+        }
+        move_index++;
+
+        if (move_eval >= beta) {
+            register_killers(0, it);
+            if (!it.is_capture() && it.get_special_flag() == MOVE_NORMAL) {
+                register_history_move(depth, it, 0);
+            }
+            best_move = it;
+            score = beta;
+            return true;
+        }
     }
 
-    search_finished_message(best_move, max_depth, max_eval);
-    time_handler.stop();
-    return best_move;
+    score = alpha;
+    return true;
 }
 
+bool Search::search_root_mtdf(unsigned int depth, MoveList& moves, bool is_in_check, Move& best_move, int& eval) {
+    // MTD(f): converges on the root score with null window probes, starting from the previous iteration's eval
+    // negamax fails hard, so each probe only moves one bound to beta; the window steps out from the guess with a
+    // doubling step and bisects once both bounds are known, leaving the TT to make repeated probes cheap
+    int lower_bound = -MAXMATE - 1;
+    int upper_bound = MAXMATE + 1;
+    int guess = eval;
+    int step = MTDF_START_STEP;
+    Move local_best_move = best_move;
+    Move probe_best_move = best_move;
+
+    root_later_moves = 0;
+    root_later_fail_highs = 0;
+
+    while (lower_bound < upper_bound) {
+        int score;
+        int beta = std::max(lower_bound + 1, std::min(guess, upper_bound));
+
+        if (!mtdf_probe(depth, moves, is_in_check, beta, probe_best_move, score)) {
+            return false;
+        }
 
-long Search::perft(unsigned int depth) {
-
-    if (depth == 0) {
-//        print_board();
-        return 1;
+        if (score >= beta) {
+            lower_bound = score;
+            local_best_move = probe_best_move;
+            guess = upper_bound > MAXMATE ? lower_bound + step : (lower_bound + upper_bound + 1) / 2;
+        } else {
+            upper_bound = score;
+            guess = lower_bound < -MAXMATE ? upper_bound - step + 1 : (lower_bound + upper_bound + 1) / 2;
+        }
+        step *= 2;
     }
 
-    long nodes = 0;
-
-    MoveList moves;
-    board.generate_moves(moves);
+    eval = lower_bound;
+    best_move = local_best_move;
+    root_best_index = 0;
+    return true;
+}
 
 
-    for (auto it = moves.begin(); it != moves.end(); ++it) {
-        board.make_move(*it);
-        nodes += perft(depth - 1);
+void Search::ybw_root_work(RootSplit& split) {
+    // Takes root moves from the split until none are left or one fails high
+    while (true) {
+        std::unique_lock<std::mutex> lock(split.lock);
+        if (split.stop_work || split.next >= (unsigned int) split.moves.size()) {
+            return;
+        }
+        unsigned int index = split.next++;
+        Move move = split.moves[index];
+        unsigned int depth = split.depth;
+        int alpha = split.alpha;
+        int beta = split.beta;
+        bool do_lmr = split.do_lmr;
+        bool do_pvs = split.do_pvs;
+        lock.unlock();
+
+        int move_eval;
+        U64 nodes_before = nodes_searched;
+        nodes_searched++;
+        line_moves[0] = move;
+        board.make_move(move);
+
+        // The eldest brother was move 0, so this is move index + 1 of the node
+        unsigned int effective_depth = determine_depth(depth, index + 1, move, do_lmr, true, true, 0);
+
+        working_split = &split;
+        try {
+            pvs_lmr_core(alpha, beta, 0, 0, do_pvs, move_eval, effective_depth, depth);
+        } catch (SearchTimeout& e) {
+            // The board is back at the root, but a singular search cut short leaves its excluded move behind
+            working_split = nullptr;
+            for (int i = 0; i < MAX_PLY; i++) {
+                excluded_moves[i] = Move();
+            }
+            lock.lock();
+            // Only a real timeout ends the search, a move dropped after another failed high just ends the split
+            if (!split.failed_high) {
+                split.timed_out = true;
+            }
+            split.stop_work = true;
+            return;
+        }
+        working_split = nullptr;
         board.unmake_move();
-    }
-    return nodes;
-}
-
-long Search::sort_perft(unsigned int depth) {
 
-    if (depth == 0) {
-//        print_board();
-        return 1;
+        lock.lock();
+        split.move_nodes[index] = nodes_searched - nodes_before;
+        if (move_eval > split.alpha) {
+            split.alpha = move_eval;
+            split.best_move = move;
+            split.best_index = index;
+        }
+        if (move_eval >= split.beta) {
+            split.failed_high = true;
+            split.stop_work = true;
+        }
     }
+}
 
-    long nodes = 0;
+void Search::ybw_helper_loop() {
+    // Waits for the main thread to open a root split, helps with it, and waits for the next one
+    RootSplit& split = *main_thread->root_split;
+    unsigned int seen_generation = 0;
+    std::unique_lock<std::mutex> lock(split.lock);
+    while (true) {
+        split.cv.wait(lock, [&split, seen_generation] { return split.quit || split.generation != seen_generation; });
+        if (split.quit) {
+            return;
+        }
+        seen_generation = split.generation;
+        split.active++;
+        lock.unlock();
 
-    MoveList moves;
-    Move blank[2];
-    board.generate_moves(moves);
-    assign_move_scores(moves, HashMove(), blank);
+        ybw_root_work(split);
 
-    MovePicker move_picker(moves);
-    while (!move_picker.finished()) {
-        auto it = ++move_picker;
-
-        board.make_move(it);
-        nodes += sort_perft(depth - 1);
-        board.unmake_move();
+        lock.lock();
+        split.active--;
+        split.cv.notify_all();
     }
+}
 
-    return nodes;
+void Search::helper_search(unsigned int max_depth) {
+    // Lazy SMP and ABDADA helpers run their own iterative deepening; odd threads skip depth 1 so the threads
+    // are spread over neighbouring depths
+    iterative_deepening(max_depth);
 }
 
-long Search::hash_perft(unsigned int depth) {
-    tt.clear();
-    long result = hash_perft_internal(depth);
-    tt.clear();
-    return result;
+void Search::start_helpers(unsigned int max_depth) {
+    if (num_threads <= 1) {
+        return;
+    }
+    if (parallel_mode == ybwc && root_driver == mtdf) {
+        // MTD(f) probes never open a root split, so the helpers would only wait; they search on their own instead
+        parallel_mode = lazy_smp;
+        if (!silent) {
+            get_synced_cout().print("info string YBWC does not split MTD(f) probes, using Lazy SMP\n");
+        }
+    }
+    if (parallel_mode == ybwc) {
+        root_split.reset(new RootSplit());
+        root_split->generation = 0;
+        root_split->active = 0;
+        root_split->quit = false;
+        root_split->stop_work = false;
+    }
+    for (unsigned int i = 1; i < num_threads; i++) {
+        Search* helper = new Search(board, tt, opening_book, time_handler);
+        helper->thread_id = i;
+        helper->num_threads = num_threads;
+        helper->parallel_mode = parallel_mode;
+        helper->main_thread = this;
+        helper->silent = true;
+        // Helpers search the same root as the main thread: the same lines, driver, moves and mate target
+        // They share its TimeHandler and node limit, so a helper stops on the same limits as the main thread
+        helper->multi_pv = multi_pv;
+        helper->node_limit = node_limit;
+        helper->root_driver = root_driver;
+        helper->search_moves = search_moves;
+        helper->mate_limit = mate_limit;
+        helper->reset_search_state();
+        helpers.emplace_back(helper);
+    }
+    for (auto it = helpers.begin(); it != helpers.end(); ++it) {
+        Search* helper = it->get();
+        if (parallel_mode == ybwc) {
+            helper_tasks.run(get_thread_pool(), [helper] { helper->ybw_helper_loop(); });
+        } else {
+            helper_tasks.run(get_thread_pool(), [helper, max_depth] { helper->helper_search(max_depth); });
+        }
+    }
 }
 
-long Search::hash_perft_internal(unsigned int depth) {
-    if (depth == 0) {
-        return 1;
+void Search::stop_helpers() {
+    // The main thread has stopped the timer by now, so helpers still searching will time out
+    if (root_split) {
+        std::lock_guard<std::mutex> lock(root_split->lock);
+        root_split->quit = true;
+        root_split->cv.notify_all();
     }
+    helper_tasks.wait();
+    for (auto it = helpers.begin(); it != helpers.end(); ++it) {
+        finished_helper_nodes += (*it)->nodes_searched;
+        finished_helper_tt_probes += (*it)->stats.tt_probes;
+        finished_helper_tt_hits += (*it)->stats.tt_hits;
+    }
+    helpers.clear();
+    root_split.reset();
+}
 
-    TT_result tt_result = tt.get(board.get_z_key());
+void Search::reset_search_state() {
+    nodes_searched = 0;
+    published_nodes = 0;
+    finished_helper_nodes = 0;
+    finished_helper_tt_probes = 0;
+    finished_helper_tt_hits = 0;
+    root_node_counts.clear();
+    stats = SearchStats();
+    nmp_verifying = false;
 
-    if (tt_result.is_hit && tt_result.tt_entry.hash_move.get_depth() == depth) {
-//        if (tt_result.sanity_check != board.tt_sanity_check()) {
-//            std::cout << "Type 1 collision occured" << std::endl;
-//        }
-//        std::cout << tt_result.sanity_check << ' ' << board.tt_sanity_check() << '\n';
-        return tt_result.tt_entry.score;
+    // Clear killers
+    for (int i = 0; i < MAX_PLY; i++) {
+        killer_moves[i][0] = Move();
+        killer_moves[i][1] = Move();
+        excluded_moves[i] = Move();
     }
+    // Allocated here rather than in the constructor, so a Search that only evaluates positions (MCTS leaves)
+    // never pays for it
+    continuation_history[0].resize(2 * 384 * 384);
+    continuation_history[1].resize(2 * 384 * 384);
+    clear_history();
+}
 
-    long nodes = 0;
+Move Search::find_best_move(unsigned int max_depth = MAX_DEPTH) {
+    max_depth = std::min(max_depth, (unsigned int) MAX_DEPTH);
+    board.hash();
+    tt.increment_age();
+    type2collision = 0;
+    reset_search_state();
 
-    MoveList moves;
-    board.generate_moves(moves);
+    time_handler.start();
 
+    // Searches with explicit limits want the engine's own answer, not a random book line
+    bool is_limited = max_depth < MAX_DEPTH || node_limit || mate_limit || !search_moves.empty();
 
-    for (auto it = moves.begin(); it != moves.end(); ++it) {
-        board.make_move(*it);
-        nodes += hash_perft_internal(depth - 1);
-        board.unmake_move();
+    // Check opening_book
+    if (USE_BOOK && !is_limited && opening_book.can_use_book() && board.get_reg_starting_pos()) {
+        Move book_move = opening_book.request(board.get_move_stack());
+        if (!book_move.is_illegal()) {
+            time_handler.stop();
+            search_finished_message(book_move, 0, 0, true);
+            return book_move;
+        }
     }
 
-    // Write data to transposition table
-    tt.set(board.get_z_key(), Move(), depth, NODE_EXACT, (int) nodes);
-
-    return nodes;
+    start_helpers(max_depth);
+    Move best_move = iterative_deepening(max_depth);
+    stop_helpers();
+    return best_move;
 }
 
+Move Search::iterative_deepening(unsigned int max_depth) {
+    // Only the main thread reports and stops the timer, which also stops the helpers
+    bool is_in_check;
+    MoveList moves;
+    board.generate_moves(moves, is_in_check);
+    eval_stack[0] = is_in_check ? NO_EVAL : board.static_eval();
+
+    // Restrict the root to searchmoves, ignoring any that aren't legal here
+    if (!search_moves.empty()) {
+        MoveList restricted_moves;
+        for (auto it = moves.begin(); it != moves.end(); ++it) {
+            for (auto sm = search_moves.begin(); sm != search_moves.end(); ++sm) {
+                if (*sm == *it) {
+                    restricted_moves.push_back(*it);
+                    break;
+                }
+            }
+        }
+        if (restricted_moves.size() != 0) {
+            moves = restricted_moves;
+        }
+    }
 
-long Search::capture_perft(unsigned int depth) {
-    int captures = 0;
-
-    if (depth == 0) {
-//        print_board();
-        return 1;
+    // Don't bother searching if there's one legal move
+    if (moves.size() == 1) {
+        search_finished_message(moves[0], 0, 0);
+        return moves[0];
     }
 
-    long nodes = 0;
+    // Best verified move and score of each line, best line first
+    unsigned int num_pv = std::min(multi_pv, (unsigned int) moves.size());
+    Move pv_moves[MAX_MULTI_PV];
+    int pv_evals[MAX_MULTI_PV] = {0};
 
-    MoveList moves;
-    board.generate_moves(moves);
+    // Iterative deepening loop
+    int depth;
+    for (depth = 1 + thread_id % 2; depth <= (int) max_depth; depth++) {
+
+        // Each line searches the root moves not already taken by a better line of this iteration
+        for (unsigned int pv_index = 0; pv_index < num_pv; pv_index++) {
+            MoveList line_moves;
+            for (auto it = moves.begin(); it != moves.end(); ++it) {
+                bool excluded = false;
+                for (unsigned int i = 0; i < pv_index; i++) {
+                    excluded |= pv_moves[i] == *it;
+                }
+                if (!excluded) {
+                    line_moves.push_back(*it);
+                }
+            }
+
+            bool completed = root_driver == mtdf ?
+                             search_root_mtdf(depth, line_moves, is_in_check, pv_moves[pv_index], pv_evals[pv_index]) :
+                             search_root(depth, line_moves, is_in_check, pv_moves[pv_index], pv_evals[pv_index]);
+            if (!completed) {
+                // Lines after the first are only extra info, so the first line of this iteration can still be played
+                // Lines that completed this iteration are reported at its depth; the one cut short and those after it
+                // would only repeat last iteration's results under the new depth, so they aren't reported
+                for (unsigned int i = 1; i < pv_index; i++) {
+                    log_search_info(depth, pv_evals[i], pv_moves[i], i + 1);
+                }
+                Move m = pv_moves[0];
+                search_finished_message(m, pv_index == 0 ? depth - 1 : depth, pv_evals[0]);
+                if (thread_id == 0) {
+                    time_handler.stop();
+                }
+                return m;
+            }
 
-    MoveList capture_moves;
-    board.generate_moves<CAPTURES_ONLY>(capture_moves);
+            if (debug && pv_index == 0) {
+                log_root_info(depth);
+                log_search_stats();
+            }
+        }
 
+        // Keep lines sorted by score in case a later line came back better than an earlier one
+        for (unsigned int i = 1; i < num_pv; i++) {
+            for (unsigned int j = i; j > 0 && pv_evals[j] > pv_evals[j - 1]; j--) {
+                std::swap(pv_evals[j], pv_evals[j - 1]);
+                std::swap(pv_moves[j], pv_moves[j - 1]);
+            }
+        }
 
-    for (auto it = moves.begin(); it != moves.end(); ++it) {
-        board.make_move(*it);
-        nodes += capture_perft(depth - 1);
-        board.unmake_move();
+        Move best_move = pv_moves[0];
+        int max_eval = pv_evals[0];
 
-        if (it->is_capture()) {
-            captures++;
+        HashMove h_best_move;
+        h_best_move = best_move;
+        store_pos_result(h_best_move, depth, NODE_EXACT, max_eval, 0);
+
+        if (thread_id == 0 && iteration_callback) {
+            iteration_callback(depth, best_move, max_eval);
         }
-    }
 
-    assert(captures == capture_moves.size());
+        // In the case of finding checkmate, end search early
+        // If we've found the shortest possible checkmate, exit early
+        // Also stop once go mate's target has been reached
+        if (max_eval >= MINMATE &&
+            (MAXMATE - max_eval <= depth || (mate_limit && (MAXMATE - max_eval + 1) / 2 <= (int) mate_limit))) {
+            search_finished_message(best_move, depth, max_eval);
+            if (thread_id == 0) {
+                time_handler.stop();
+            }
+            return best_move;
+        }
+
+        // Send this iteration's info to the gui
+        for (unsigned int i = 0; i < num_pv; i++) {
+            log_search_info(depth, pv_evals[i], pv_moves[i], i + 1);
+        }
+    }
 
-    return nodes;
+    search_finished_message(pv_moves[0], max_depth, pv_evals[0]);
+    if (thread_id == 0) {
+        time_handler.stop();
+    }
+    return pv_moves[0];
 }
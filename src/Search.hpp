@@ -14,7 +14,10 @@
 #include "Opening_book.hpp"
 #include "Time_handler.hpp"
 
+#include <memory>
+
 #define MAX_DEPTH 64
+#define MAX_MULTI_PV 64
 #define MAXMATE 2000000
 #define MINMATE 1999000
 #define PRUNE_MOVE_SCORE 0
@@ -28,23 +31,134 @@
 #define USE_DELTA_PRUNING 0
 #define USE_LATE_MOVE_REDUCTION 1
 #define USE_BOOK 1
-#define R 2
-
 
-extern unsigned int lmr_values[256];
+// Null move reduction = NMP_BASE_R + depth / NMP_DEPTH_DIVISOR + (static eval - beta) / NMP_EVAL_DIVISOR
+// The eval term is capped at NMP_MAX_EVAL_R; cutoffs at depth >= NMP_VERIFY_DEPTH are verified without null moves
+#define NMP_BASE_R 2
+#define NMP_DEPTH_DIVISOR 4
+#define NMP_EVAL_DIVISOR 200
+#define NMP_MAX_EVAL_R 3
+#define NMP_VERIFY_DEPTH 8
+
+// Late move reduction = LMR_BASE + log(depth) * log(move count) / LMR_DIVISOR
+#define LMR_BASE 0.75
+#define LMR_DIVISOR 2.25
+#define LMR_MIN_MOVES 3 // Moves searched before any move is reduced
+#define LMR_HISTORY_DIVISOR 16384 // Every LMR_HISTORY_DIVISOR of quiet history reduces one ply less (more if negative)
+
+// Quiet history (butterfly plus continuation history one and two plies back)
+// Gravity updates keep every entry within +-HISTORY_MAX
+#define USE_COUNTER_MOVES 1
+#define USE_CONTINUATION_HISTORY 1
+#define HISTORY_MAX 16384
+#define HISTORY_BONUS_SCALE 32 // Bonus is HISTORY_BONUS_SCALE * depth^2, capped at HISTORY_BONUS_MAX
+#define HISTORY_BONUS_MAX 1200
+#define HISTORY_ORDER_DIVISOR 1024 // Quiet history per point of move score
+
+// Late move pruning skips quiets after LMP_BASE + depth^2 moves (half as many when not improving)
+#define USE_LATE_MOVE_PRUNING 1
+#define LMP_MAX_DEPTH 3
+#define LMP_BASE 3
+
+// History pruning skips quiets whose history is below -HISTORY_PRUNE_MARGIN * depth
+#define USE_HISTORY_PRUNING 1
+#define HISTORY_PRUNE_MAX_DEPTH 3
+#define HISTORY_PRUNE_MARGIN 2048
+
+// Captures are ordered by victim value plus capture history, neutral ones just above the killers
+#define CAPTURE_ORDER_BASE 66
+#define CAPTURE_MVV_DIVISOR 40
+#define CAPTURE_HISTORY_ORDER_DIVISOR 1024
+#define CAPTURE_HISTORY_ORDER_LIMIT 16
+
+// SEE pruning skips captures losing more than SEE_PRUNE_MARGIN * depth
+#define USE_SEE_PRUNING 1
+#define SEE_PRUNE_MAX_DEPTH 4
+#define SEE_PRUNE_MARGIN 100
+
+// Static eval pruning, all disabled in PV nodes and when in check
+// Reverse futility: return beta if static eval - RFP_MARGIN * depth still beats it
+#define USE_REVERSE_FUTILITY_PRUNING 1
+#define RFP_MAX_DEPTH 5
+#define RFP_MARGIN 90
+// Razoring: drop into quiescence search if static eval + RAZOR_MARGIN * depth can't reach alpha
+#define USE_RAZORING 1
+#define RAZOR_MAX_DEPTH 2
+#define RAZOR_MARGIN 250
+// Futility: skip quiets that can't raise static eval + FUTILITY_BASE + FUTILITY_MARGIN * depth above alpha
+#define USE_FUTILITY_PRUNING 1
+#define FUTILITY_MAX_DEPTH 3
+#define FUTILITY_BASE 80
+#define FUTILITY_MARGIN 100
+
+// Singular extensions: extend the TT move by one ply if every other move fails low against
+// tt score - SE_MARGIN * depth in a search of half the depth; if even that bound beats beta, cut the node instead
+#define USE_SINGULAR_EXTENSIONS 1
+#define SE_MIN_DEPTH 6
+#define SE_TT_DEPTH_MARGIN 3 // TT entry must be at least this close to the current depth
+#define SE_MARGIN 2
+
+// ProbCut: in non-PV nodes, a good capture that beats beta + PROBCUT_MARGIN in a search
+// PROBCUT_REDUCTION plies shallower is trusted to beat beta at full depth
+#define USE_PROBCUT 1
+#define PROBCUT_MIN_DEPTH 5
+#define PROBCUT_REDUCTION 4
+#define PROBCUT_MARGIN 200
+
+// Nodes at depth >= IID_MIN_DEPTH without a TT move either get a search IID_REDUCTION plies shallower
+// to find one (internal iterative deepening), or are searched one ply shallower (internal iterative reduction)
+#define USE_INTERNAL_ITERATIVE_DEEPENING 0
+#define USE_INTERNAL_ITERATIVE_REDUCTION 1
+#define IID_MIN_DEPTH 5
+#define IID_REDUCTION 2
+
+// MTD(f) steps its null window away from the guess by MTDF_START_STEP, doubling until the score is bracketed
+#define MTDF_START_STEP 16
+
+#define MAX_PLY (MAX_DEPTH + EXTENSION_LIMIT + 1)
+#define NO_EVAL (-MAXMATE - 1)
+
+
+extern unsigned int lmr_table[MAX_DEPTH + 1][256];
+
+// How each iteration of find_best_move converges on the root score
+enum RootDriver {
+    aspiration_windows,
+    mtdf,
+};
 
 void init_search();
 
+std::string print_move_vector(std::vector<Move> moves);
+
+// How the helper threads share the work when Threads > 1
+enum ParallelMode {
+    lazy_smp, // Independent searches sharing the TT
+    abdada, // Lazy SMP, with moves another thread is searching deferred to the end of the move list
+    ybwc, // Young Brothers Wait at the root: the first move is searched alone, the rest are split between threads
+};
+
+#define ABDADA_MIN_DEPTH 3 // Only moves searched at least this deep are marked and deferred
+
 class MovePicker {
 private:
     MoveList& moves;
     int size, visit_count;
+
+    // Moves put off until every other move has been picked
+    Move deferred[256];
+    int deferred_count, deferred_visits;
 public:
     MovePicker(MoveList& init_moves);
 
     int finished();
 
     Move operator++();
+
+    void defer(Move move);
+
+    // Whether the last move picked had been deferred before
+    bool is_revisit();
 };
 
 
@@ -52,6 +166,54 @@ struct SearchTimeout : public std::exception {
 };
 
 
+// Root moves after the first, handed out to threads one at a time under YBWC
+struct RootSplit {
+    std::mutex lock;
+    std::condition_variable cv;
+    unsigned int generation; // Bumped for every new split so waiting helpers join it
+    unsigned int active; // Threads currently working on the split
+    bool quit;
+
+    MoveList moves;
+    std::vector<U64> move_nodes;
+    unsigned int next;
+    unsigned int depth;
+    int alpha, beta;
+    bool do_lmr, do_pvs;
+
+    // Polled without the lock by should_stop, so a thread drops its move as soon as the split is over
+    std::atomic<bool> stop_work;
+    bool timed_out, failed_high;
+    Move best_move;
+    unsigned int best_index;
+};
+
+struct SearchStats {
+    U64 lmr_reductions; // Searches done at reduced depth
+    U64 lmr_researches; // Reduced searches that beat alpha and had to be repeated at full depth
+    U64 lmp_pruned; // Quiets skipped by late move pruning
+    U64 history_pruned; // Quiets skipped for having a bad history
+    U64 rfp_cutoffs; // Nodes cut by reverse futility pruning
+    U64 razor_cutoffs; // Nodes resolved by razoring
+    U64 futility_pruned; // Quiets skipped by futility pruning
+    U64 nmp_tries; // Null move searches
+    U64 nmp_cutoffs; // Nodes cut by null move pruning
+    U64 nmp_verify_failures; // Null move cutoffs that the verification search refuted
+    U64 se_tries; // Singular searches
+    U64 se_extensions; // TT moves found singular and extended
+    U64 multicut_cutoffs; // Nodes cut because an alternative to the TT move also beat beta
+    U64 probcut_tries; // Captures searched by ProbCut
+    U64 probcut_cutoffs; // Nodes cut by ProbCut
+    U64 iid_searches; // Shallower searches run to find a missing TT move
+    U64 iir_reductions; // Nodes reduced for missing a TT move
+    U64 see_pruned; // Losing captures skipped by SEE pruning
+    U64 beta_cutoffs; // Fail-highs in negamax
+    U64 first_move_cutoffs; // Fail-highs caused by the first move searched
+    U64 tt_probes; // TT lookups in negamax
+    U64 tt_hits; // Lookups that found an entry for the position
+};
+
+
 class Search {
 private:
     Board board;
@@ -59,26 +221,156 @@ private:
     OpeningBook& opening_book;
     TimeHandler& time_handler;
 
-    Move killer_moves[MAX_DEPTH][2];
-    unsigned int history_moves[2][64][64];
+    Move killer_moves[MAX_PLY][2];
+    int history_moves[2][64][64];
+
+    // Quiet history by the (piece, to) of the move one and two plies earlier: [side][previous piece-to][piece-to]
+    // Empty until reset_search_state, the start of every search
+    std::vector<int> continuation_history[2];
+
+    // Quiet that last refuted each opponent move: [side][piece][to]
+    Move counter_moves[2][8][64];
+
+    // Capture outcomes: [side][piece moved][to][piece captured]
+    int capture_history[2][8][64][8];
+
+    // Moves made on the current line, null for null moves
+    Move line_moves[MAX_PLY];
 
-    unsigned int nodes_searched;
+    // Static eval of each node on the current line, NO_EVAL when in check
+    int eval_stack[MAX_PLY];
+
+    // Move skipped by the singular extension search at each ply, null if none
+    Move excluded_moves[MAX_PLY];
+
+    // Set during a null move verification search, which keeps null moves off in its whole subtree
+    bool nmp_verifying;
+
+    SearchStats stats;
+
+    U64 nodes_searched;
+
+    unsigned int multi_pv;
+
+    // Optional limits from the go command, 0 or empty if unused
+    U64 node_limit;
+    unsigned int mate_limit;
+    std::vector<Move> search_moves;
+
+    // Nodes spent below each root move in its latest search, used to order the next iteration
+    std::vector<std::pair<Move, U64>> root_node_counts;
+    unsigned int root_best_index, root_later_moves, root_later_fail_highs;
+
+    RootDriver root_driver;
+
+    bool debug;
+
+    // Suppresses info and bestmove output, for searches run by benchmarks and helper threads
+    bool silent;
+
+    // Called by the main thread after every completed iteration with its depth, best move and score
+    std::function<void(unsigned int, Move, int)> iteration_callback;
+
+    // Parallel search: the main thread (thread_id 0) owns and starts the helpers, which point back to it
+    unsigned int thread_id;
+    unsigned int num_threads;
+    ParallelMode parallel_mode;
+    Search* main_thread;
+    std::vector<std::unique_ptr<Search>> helpers;
+    Thread::TaskGroup helper_tasks;
+    std::unique_ptr<RootSplit> root_split;
+
+    // The split this thread is searching a move of, null outside ybw_root_work
+    RootSplit* working_split;
+
+    // nodes_searched as last seen by other threads
+    std::atomic<U64> published_nodes;
+
+    // Nodes of helpers that have already been stopped this search
+    U64 finished_helper_nodes;
+
+    // TT lookups and hits of helpers that have already been stopped this search
+    U64 finished_helper_tt_probes;
+    U64 finished_helper_tt_hits;
 public:
 
     Search(Board b, TT& t, OpeningBook& ob, TimeHandler& th);
 
+    void clear_history();
+
+    // The position being searched, for drivers that walk the tree themselves before calling into the search
+    Board& get_board();
+
+    void set_multi_pv(unsigned int n);
+
+    void set_node_limit(U64 n);
+
+    void set_mate_limit(unsigned int n);
+
+    void set_search_moves(std::vector<Move> m);
+
+    bool should_stop();
+
+    // get_total_nodes from the published counts only, so any thread can call it on the main thread
+    U64 get_published_total_nodes();
+
+    void set_debug(bool b);
+
+    void set_root_driver(RootDriver d);
+
+    void set_silent(bool b);
+
+    // For drivers that watch the best move converge, such as the EPD runner
+    void set_iteration_callback(std::function<void(unsigned int, Move, int)> f);
+
+    U64 get_nodes_searched();
+
+    // Nodes of the main thread and all of its helpers
+    U64 get_total_nodes();
+
+    // Share of negamax TT lookups that hit, over the main thread and its helpers once they have stopped
+    double get_tt_hit_rate();
+
+    void set_threads(unsigned int n);
+
+    void set_parallel_mode(ParallelMode m);
+
+    void reset_search_state();
+
+    void start_helpers(unsigned int max_depth);
+
+    void stop_helpers();
+
+    void helper_search(unsigned int max_depth);
+
+    void ybw_helper_loop();
+
+    void ybw_root_work(RootSplit& split);
+
     template <bool use_history_heuristic = false>
-    void assign_move_scores(MoveList &moves, HashMove hash_move, Move killers[2]);
+    void assign_move_scores(MoveList &moves, HashMove hash_move, Move killers[2], unsigned int ply_from_root = 0);
 
     template <bool use_delta_pruning>
     void assign_move_scores_quiescent(MoveList &moves, int eval, int alpha);
 
+    void order_root_moves(MoveList& moves, HashMove best_move);
+
+    void record_root_nodes(Move move, U64 nodes);
+
+    void log_root_info(int depth);
+
+    void log_search_stats();
+
     std::vector<Move> get_pv();
 
+    std::vector<Move> get_pv(Move first_move);
+
+    U64 position_key(unsigned int ply_from_root);
+
     void store_pos_result(HashMove best_move, unsigned int depth, unsigned int node_type, int score,
                           unsigned int ply_from_root);
 
-    void log_search_info(int depth, int eval, bool book_move = false);
+    void log_search_info(int depth, int eval, Move pv_move, unsigned int pv_index = 1, bool book_move = false);
 
     void search_finished_message(Move best_move, int depth, int eval, bool book_move = false);
 
@@ -86,26 +378,44 @@ public:
 
     void register_killers(unsigned int ply_from_root, Move move);
 
-    void register_history_move(unsigned int depth, Move move);
+    int* continuation_entry(unsigned int plies_back, unsigned int side, Move move, unsigned int ply_from_root);
 
-    int quiescence_search(unsigned int ply_from_horizon, int alpha, int beta, unsigned int ply_from_root);
+    int quiet_history(unsigned int side, Move move, unsigned int ply_from_root);
 
-    Move find_best_move(unsigned int max_depth);
+    void update_quiet_history(int bonus, Move move, unsigned int ply_from_root);
+
+    void register_history_move(unsigned int depth, Move move, unsigned int ply_from_root);
 
-    long perft(unsigned int depth);
+    void penalize_history_move(unsigned int depth, Move move, unsigned int ply_from_root);
 
-    long sort_perft(unsigned int depth);
+    int& capture_history_entry(Move move);
 
-    long hash_perft(unsigned int depth);
+    void update_capture_history(unsigned int depth, Move move, bool is_cutoff);
 
-    long hash_perft_internal(unsigned int depth);
+    void register_counter_move(unsigned int ply_from_root, Move move);
+
+    Move get_counter_move(unsigned int ply_from_root);
+
+    bool is_quiet_prunable(unsigned int depth, unsigned int move_count, Move move, bool improving,
+                           unsigned int ply_from_root);
+
+    int quiescence_search(unsigned int ply_from_horizon, int alpha, int beta, unsigned int ply_from_root);
+
+    bool search_root(unsigned int depth, MoveList& moves, bool is_in_check, Move& best_move, int& eval);
+
+    bool mtdf_probe(unsigned int depth, MoveList& moves, bool is_in_check, int beta, Move& best_move, int& score);
+
+    bool search_root_mtdf(unsigned int depth, MoveList& moves, bool is_in_check, Move& best_move, int& eval);
+
+    Move find_best_move(unsigned int max_depth);
 
-    long capture_perft(unsigned int depth);
+    Move iterative_deepening(unsigned int max_depth);
 
     void pvs_lmr_core(int alpha, int beta, unsigned int ply_from_root, unsigned int ply_extended, bool do_pvs, int& eval,
                       unsigned int effective_depth, unsigned int depth);
 
-    unsigned int determine_depth(unsigned int effective_depth, unsigned int depth_reduction_value, Move move, bool do_lmr);
+    unsigned int determine_depth(unsigned int depth, unsigned int move_count, Move move, bool do_lmr, bool is_pv,
+                                 bool improving, unsigned int ply_from_root);
 };
 
 #endif /* Search_hpp */
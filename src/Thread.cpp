@@ -52,6 +52,221 @@ namespace Thread {
         return q.empty();
     }
 
+    WorkStealingDeque::WorkStealingDeque(unsigned int capacity) : buffer(capacity) {
+        assert((capacity & (capacity - 1)) == 0);
+        top = 0;
+        bottom = 0;
+    }
+
+    bool WorkStealingDeque::push(Task* task) {
+        long long b = bottom.load(std::memory_order_relaxed);
+        long long t = top.load(std::memory_order_acquire);
+        if (b - t >= (long long) buffer.size()) {
+            return false;
+        }
+        buffer[b & (buffer.size() - 1)].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Task* WorkStealingDeque::pop() {
+        long long b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Task* task = buffer[b & (buffer.size() - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last task, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task* WorkStealingDeque::steal() {
+        long long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        Task* task = buffer[t & (buffer.size() - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return task;
+    }
+
+    // Index of the pool worker running on this thread, -1 on other threads
+    thread_local int worker_index = -1;
+
+    ThreadPool::ThreadPool(unsigned int n) {
+        start(n);
+    }
+
+    ThreadPool::~ThreadPool() {
+        stop();
+    }
+
+    void ThreadPool::start(unsigned int n) {
+        quit = false;
+        pending = 0;
+        deques.clear();
+        for (unsigned int i = 0; i < n; i++) {
+            deques.emplace_back(new WorkStealingDeque());
+        }
+        for (unsigned int i = 0; i < n; i++) {
+            workers.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    void ThreadPool::stop() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            quit = true;
+        }
+        c.notify_all();
+        for (auto it = workers.begin(); it != workers.end(); ++it) {
+            it->join();
+        }
+        workers.clear();
+
+        // Tasks nobody ran are dropped
+        for (auto it = deques.begin(); it != deques.end(); ++it) {
+            while (Task* task = (*it)->pop()) {
+                delete task;
+            }
+        }
+        for (auto it = injector.begin(); it != injector.end(); ++it) {
+            delete *it;
+        }
+        injector.clear();
+    }
+
+    void ThreadPool::resize(unsigned int n) {
+        n = std::max(1U, std::min(n, (unsigned int) MAX_THREADS));
+        if (n != workers.size()) {
+            stop();
+            start(n);
+        }
+    }
+
+    unsigned int ThreadPool::size() {
+        return workers.size();
+    }
+
+    void ThreadPool::submit(Task task) {
+        Task* t = new Task(std::move(task));
+        bool queued = worker_index >= 0 && (unsigned int) worker_index < deques.size() && deques[worker_index]->push(t);
+        std::lock_guard<std::mutex> lock(m);
+        if (!queued) {
+            injector.push_back(t);
+        }
+        pending++;
+        c.notify_one();
+    }
+
+    Task* ThreadPool::take_task(int own_index) {
+        Task* task = nullptr;
+        if (own_index >= 0) {
+            task = deques[own_index]->pop();
+        }
+        if (!task) {
+            std::lock_guard<std::mutex> lock(m);
+            if (!injector.empty()) {
+                task = injector.front();
+                injector.pop_front();
+            }
+        }
+        for (unsigned int i = 1; !task && i <= deques.size(); i++) {
+            unsigned int victim = (own_index + i) % deques.size();
+            if ((int) victim != own_index) {
+                task = deques[victim]->steal();
+            }
+        }
+        if (task) {
+            pending--;
+        }
+        return task;
+    }
+
+    void ThreadPool::worker_loop(unsigned int index) {
+        worker_index = index;
+        while (true) {
+            Task* task = take_task(index);
+            if (task) {
+                (*task)();
+                delete task;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m);
+            c.wait(lock, [this] { return quit || pending > 0; });
+            if (quit) {
+                return;
+            }
+        }
+    }
+
+    TaskGroup::TaskGroup() {
+        remaining = 0;
+    }
+
+    void TaskGroup::finish() {
+        std::lock_guard<std::mutex> lock(m);
+        remaining--;
+        c.notify_all();
+    }
+
+    void TaskGroup::run(ThreadPool& pool, Task task) {
+        std::shared_ptr<GroupTask> group_task(new GroupTask());
+        group_task->task = std::move(task);
+        group_task->claimed = false;
+        remaining++;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            queued.push_back(group_task);
+            c.notify_all();
+        }
+        // A worker that finds the task already claimed by wait drops it without touching the group, which may be
+        // gone by then
+        pool.submit([this, group_task] {
+            if (!group_task->claimed.exchange(true)) {
+                group_task->task();
+                finish();
+            }
+        });
+    }
+
+    void TaskGroup::wait() {
+        std::unique_lock<std::mutex> lock(m);
+        while (remaining > 0) {
+            std::shared_ptr<GroupTask> group_task;
+            while (!queued.empty() && !group_task) {
+                if (!queued.front()->claimed.exchange(true)) {
+                    group_task = queued.front();
+                }
+                queued.pop_front();
+            }
+            if (group_task) {
+                lock.unlock();
+                group_task->task();
+                finish();
+                lock.lock();
+                continue;
+            }
+            c.wait(lock, [this] { return remaining == 0 || !queued.empty(); });
+        }
+        // The last task may still hold the lock after dropping remaining to 0; holding it here means it let go
+    }
+
     void SyncedCout::print(const std::string& str) {
         std::unique_lock<std::mutex> guard(m);
         std::cout << str;
@@ -66,3 +281,8 @@ Thread::SyncedCout& get_synced_cout() {
     static Thread::SyncedCout synced_cout;
     return synced_cout;
 }
+
+Thread::ThreadPool& get_thread_pool() {
+    static Thread::ThreadPool thread_pool(1);
+    return thread_pool;
+}
@@ -15,6 +15,12 @@
 #include <atomic>
 #include <condition_variable>
 #include <queue>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#define MAX_THREADS 256
+#define POOL_DEQUE_CAPACITY 4096 // Power of 2, a worker's tasks overflow into the injector queue past this
 
 namespace Thread {
 
@@ -35,6 +41,85 @@ namespace Thread {
         bool is_empty();
     };
 
+    typedef std::function<void()> Task;
+
+    // Chase-Lev work-stealing deque of fixed capacity: its owner pushes and pops at the bottom without locking,
+    // other workers steal from the top
+    class WorkStealingDeque {
+    private:
+        std::vector<std::atomic<Task*>> buffer;
+        std::atomic<long long> top, bottom;
+    public:
+        explicit WorkStealingDeque(unsigned int capacity = POOL_DEQUE_CAPACITY);
+
+        // Owner only, false if the deque is full
+        bool push(Task* task);
+
+        // Owner only, nullptr if empty
+        Task* pop();
+
+        // Any thread, nullptr if empty or another thread got there first
+        Task* steal();
+    };
+
+    // Workers created once and reused by every parallel feature
+    // Tasks submitted by a worker go on its own deque, the rest go on a shared injector queue; idle workers
+    // take from their own deque, then the injector, then steal from the other workers
+    class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+        std::deque<Task*> injector;
+        std::mutex m;
+        std::condition_variable c;
+        std::atomic<unsigned int> pending; // Tasks submitted and not yet taken
+        bool quit;
+
+        void worker_loop(unsigned int index);
+
+        Task* take_task(int own_index);
+
+        void start(unsigned int n);
+
+        void stop();
+    public:
+        explicit ThreadPool(unsigned int n);
+
+        ~ThreadPool();
+
+        // Only call while no tasks are running
+        void resize(unsigned int n);
+
+        unsigned int size();
+
+        void submit(Task task);
+    };
+
+    // Tasks that can be waited on together
+    class TaskGroup {
+    private:
+        // Run once, by a pool worker or by the thread waiting on the group, whichever claims it first
+        struct GroupTask {
+            Task task;
+            std::atomic<bool> claimed;
+        };
+
+        std::deque<std::shared_ptr<GroupTask>> queued; // Tasks wait hasn't looked at yet, claimed by a worker or not
+        std::atomic<unsigned int> remaining;
+        std::mutex m;
+        std::condition_variable c;
+
+        void finish();
+    public:
+        TaskGroup();
+
+        void run(ThreadPool& pool, Task task);
+
+        // Runs the group's own unclaimed tasks while waiting, so a group never waits on tasks that have no worker
+        // to run them, and the waiting thread never gets stuck in another group's work
+        void wait();
+    };
+
     class SyncedCout {
     private:
         std::mutex m;
@@ -47,4 +132,7 @@ namespace Thread {
 
 Thread::SyncedCout& get_synced_cout();
 
+// The pool shared by search, perft and batch jobs, sized by the Threads option
+Thread::ThreadPool& get_thread_pool();
+
 #endif /* Thread_hpp */
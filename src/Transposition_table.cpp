@@ -9,14 +9,6 @@
 #include "Transposition_table.hpp"
 
 
-U64 constexpr TT_SIZE() {
-    return C64(1) << TT_EXP_2_SIZE;
-}
-
-U64 constexpr TT_LOOKUP_MASK() {
-    return TT_SIZE() - 1;
-}
-
 void HashMove::operator=(Move move) {
     move_data = move.get_raw_data() & 0x3FFFFF;
 }
@@ -51,29 +43,53 @@ unsigned int upper_bits_to_u32(U64 input) {
     return (input >> 32);
 }
 
-TT::TT() {
+// Entries are written without locks, so one torn by two threads writing at once fails this check instead of
+// pairing a key with another position's data
+static inline unsigned int entry_key(const TT_entry& entry) {
+    return entry.key ^ entry.hash_move.get_raw_data() ^ (unsigned int) entry.score;
+}
+
+TT::TT(unsigned int size_mb) {
     // Constructor, allocate the hash_table
-    hash_table = new bucket[TT_SIZE()];
-    Move move;
-    for (int i = 0; i < TT_SIZE(); i++) {
-        assert((hash_table + i)->entries[0].hash_move == move);
-        assert((hash_table + i)->entries[0].key == 0);
-        assert((hash_table + i)->entries[0].score == 0);
+    hash_table = nullptr;
+    resize(size_mb);
+    searching = new std::atomic<U64>[ABDADA_TABLE_SIZE];
+    for (int i = 0; i < ABDADA_TABLE_SIZE; i++) {
+        searching[i] = 0;
     }
 }
 
 TT::~TT() {
     // Delete hash_table
     delete[] hash_table;
+    delete[] searching;
+}
+
+void TT::resize(unsigned int mb) {
+    // Largest power of two number of buckets that fits in mb
+    size_mb = std::max(1U, std::min(mb, (unsigned int) TT_MAX_MB));
+    num_buckets = 1;
+    while (num_buckets * 2 * sizeof(bucket) <= (U64) size_mb << 20) {
+        num_buckets *= 2;
+    }
+    lookup_mask = num_buckets - 1;
+
+    delete[] hash_table;
+    hash_table = new bucket[num_buckets];
+    clear();
+}
+
+unsigned int TT::get_size_mb() const {
+    return size_mb;
 }
 
 TT_result TT::get(U64 key) const {
-    U64 lower_key = key & TT_LOOKUP_MASK();
+    U64 lower_key = key & lookup_mask;
     unsigned int upper_key = upper_bits_to_u32(key);
     bucket b = *(hash_table + lower_key);
     for (int i = 0; i < BUCKET_SIZE; i++) {
         TT_entry tt_entry = b.entries[i];
-        if (tt_entry.key == upper_key) {
+        if (entry_key(tt_entry) == upper_key) {
             return TT_result{tt_entry, true};
         }
     }
@@ -81,21 +97,21 @@ TT_result TT::get(U64 key) const {
 }
 
 void TT::prefetch(U64 key) const {
-    U64 lower_key = key & TT_LOOKUP_MASK();
+    U64 lower_key = key & lookup_mask;
     __builtin_prefetch(hash_table + lower_key, 1);
 }
 
 void set_tt_entry(TT_entry& entry, unsigned int upper_key, Move best_move, unsigned int depth, unsigned int node_type, int score) {
-    entry.key = upper_key;
     entry.hash_move = best_move;
     entry.hash_move.set_depth(depth);
     entry.hash_move.set_node_type(node_type);
     entry.score = score;
     entry.age = 0;
+    entry.key = upper_key ^ entry.hash_move.get_raw_data() ^ (unsigned int) score;
 }
 
 void TT::set(U64 key, Move best_move, unsigned int depth, unsigned int node_type, int score) {
-    U64 lower_key = key & TT_LOOKUP_MASK();
+    U64 lower_key = key & lookup_mask;
     unsigned int upper_key = upper_bits_to_u32(key);
     bucket* b = hash_table + lower_key;
 
@@ -110,7 +126,7 @@ void TT::set(U64 key, Move best_move, unsigned int depth, unsigned int node_type
         unsigned int entry_depth = entry.hash_move.get_depth();
 
         // Replace empty entries or entries with matching key
-        if (entry.key == upper_key || entry.hash_move.get_raw_data() == 0) {
+        if (entry_key(entry) == upper_key || entry.hash_move.get_raw_data() == 0) {
             set_tt_entry(entry, upper_key, best_move, depth, node_type, score);
             return;
         }
@@ -159,8 +175,26 @@ void TT::set(U64 key, Move best_move, unsigned int depth, unsigned int node_type
     }
 }
 
+void TT::mark_searching(U64 move_key) {
+    searching[move_key & (ABDADA_TABLE_SIZE - 1)].store(move_key, std::memory_order_relaxed);
+}
+
+void TT::unmark_searching(U64 move_key) {
+    // Leave the slot alone if another move has claimed it since
+    U64 expected = move_key;
+    searching[move_key & (ABDADA_TABLE_SIZE - 1)].compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+}
+
+bool TT::is_being_searched(U64 move_key) const {
+    return searching[move_key & (ABDADA_TABLE_SIZE - 1)].load(std::memory_order_relaxed) == move_key;
+}
+
 void TT::increment_age() {
-    for (int i = 0; i < TT_SIZE(); i++) {
+    // Marks left behind by searches that timed out are stale now
+    for (int i = 0; i < ABDADA_TABLE_SIZE; i++) {
+        searching[i] = 0;
+    }
+    for (U64 i = 0; i < num_buckets; i++) {
         for (int j = 0; j < BUCKET_SIZE; j++) {
             TT_entry& entry = (hash_table + i)->entries[j];
             if (entry.hash_move.get_raw_data() != 0) {
@@ -172,9 +206,9 @@ void TT::increment_age() {
 
 
 void TT::clear() {
-    memset(hash_table, 0, TT_SIZE() * sizeof(*hash_table));
+    memset(hash_table, 0, num_buckets * sizeof(*hash_table));
     Move move;
-    for (int i = 0; i < TT_SIZE(); i++) {
+    for (U64 i = 0; i < num_buckets; i++) {
         assert((hash_table + i)->entries[0].hash_move == move);
         assert((hash_table + i)->entries[0].key == 0);
         assert((hash_table + i)->entries[0].score == 0);
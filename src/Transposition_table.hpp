@@ -11,13 +11,17 @@
 
 #include <algorithm>
 #include <cstring>
+#include <atomic>
 
 #include "depend.hpp"
 #include "Data_structs.hpp"
 
-#define TT_EXP_2_SIZE 22 // TT_SIZE is 2^x
+#define TT_DEFAULT_MB 256 // Sizes are rounded down to a power of 2 number of buckets
+#define TT_MAX_MB 16384
 #define BUCKET_SIZE 4
 
+#define ABDADA_TABLE_SIZE 32768 // Slots for moves being searched by some thread, a power of 2
+
 #define NODE_EXACT 0
 #define NODE_UPPERBOUND 1
 #define NODE_LOWERBOUND 2
@@ -42,7 +46,7 @@ public:
 
 
 struct TT_entry {
-    unsigned int key;
+    unsigned int key; // Upper 32 bits of the Zobrist key, xored with the move and score (lockless hashing)
     HashMove hash_move;
     // No need to keep depth info because that's kept in move
     int score;
@@ -61,11 +65,22 @@ struct TT_result {
 class TT {
 private:
     bucket* hash_table;
+    U64 num_buckets;
+    U64 lookup_mask;
+    unsigned int size_mb;
+
+    // Keys of (position, move) pairs some thread is searching right now, for ABDADA
+    std::atomic<U64>* searching;
 public:
-    TT();
+    explicit TT(unsigned int size_mb = TT_DEFAULT_MB);
 
     ~TT();
 
+    // Reallocates the table, which loses its contents; only call while no search is running
+    void resize(unsigned int size_mb);
+
+    unsigned int get_size_mb() const;
+
     TT_result get(U64 key) const;
 
     void prefetch(U64 key) const;
@@ -76,6 +91,12 @@ public:
 
     void clear();
 
+    void mark_searching(U64 move_key);
+
+    void unmark_searching(U64 move_key);
+
+    bool is_being_searched(U64 move_key) const;
+
 };
 
 
@@ -10,17 +10,34 @@
 
 UCI::UCI(Thread::SafeQueue<std::vector<std::string>>& c, std::atomic<bool>& b) : cmd_queue(c), should_end_search(b) {};
 
-void init_uci() {
+void init_uci(Thread::SafeQueue<std::vector<std::string>>& cmd_queue) {
     while (true) {
         std::string line;
         std::getline(std::cin, line);
         auto cmd = split(line);
+        if (cmd.empty()) {
+            continue;
+        }
         if (cmd[0] == "isready") {
             return;
         } else if (cmd[0] == "uci") {
             get_synced_cout().print("id name Bitboard_Chess\n");
             get_synced_cout().print("id author Andrew_Xia\n");
+            std::ostringstream buffer;
+            buffer << "option name Hash type spin default " << TT_DEFAULT_MB << " min 1 max " << TT_MAX_MB << '\n';
+            buffer << "option name MultiPV type spin default 1 min 1 max " << MAX_MULTI_PV << '\n';
+            buffer << "option name Threads type spin default 1 min 1 max " << MAX_THREADS << '\n';
+            buffer << "option name ParallelMode type combo default LazySMP var LazySMP var ABDADA var YBWC\n";
+            buffer << "option name SearchMode type combo default AlphaBeta var AlphaBeta var MCTS\n";
+            buffer << "option name MateHash type spin default " << MATE_HASH_DEFAULT_MB << " min 1 max "
+                   << MATE_HASH_MAX_MB << '\n';
+            buffer << "option name PerftHash type spin default 0 min 0 max " << PERFT_HASH_MAX_MB << '\n';
+            buffer << "option name RootDriver type combo default Aspiration var Aspiration var MTDF\n";
+            get_synced_cout().print(buffer.str());
             get_synced_cout().print("uciok\n");
+        } else if (cmd[0] == "setoption" || cmd[0] == "debug") {
+            // Options are set before the engine thread exists, so hand them over to it
+            cmd_queue.enqueue(cmd);
         }
     }
 }
@@ -13,8 +13,11 @@
 #include "Thread.hpp"
 #include "Utility.hpp"
 #include "Board.hpp"
+#include "Search.hpp"
+#include "Mate_search.hpp"
+#include "Perft.hpp"
 
-void init_uci();
+void init_uci(Thread::SafeQueue<std::vector<std::string>>& cmd_queue);
 
 class UCI {
 private:
@@ -8,6 +8,8 @@
 
 #include "Utility.hpp"
 
+#include <cmath>
+
 
 unsigned int flip_index_v(unsigned int i) {
     return i ^ 56;
@@ -209,6 +211,19 @@ std::vector<std::string> split(const std::string& line) {
     return move_strs;
 }
 
+void mean_and_stddev(const std::vector<double>& xs, double& mean, double& stddev) {
+    mean = 0;
+    for (double x : xs) {
+        mean += x;
+    }
+    mean /= xs.size();
+    double variance = 0;
+    for (double x : xs) {
+        variance += (x - mean) * (x - mean);
+    }
+    stddev = xs.size() > 1 ? std::sqrt(variance / (xs.size() - 1)) : 0;
+}
+
 namespace converter {
 
     old::piece_type piece_type_to_old(unsigned int piece) {
@@ -344,3 +359,87 @@ namespace converter {
 
 } // converter
 
+
+std::string directory_from_file(std::string str) {
+    if (str.back() == '/') {
+        str.pop_back();
+    }
+    int index = str.size() - 1;
+    for (auto it = str.rbegin(); it != str.rend(); it++) {
+        if ((*it) == '/') {
+            break;
+        }
+        index--;
+    }
+    return str.substr(0, index + 1);
+}
+
+// Define resource_path();
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+std::string resource_path() {
+    char pBuf[1024];
+    size_t len = sizeof(pBuf);
+    int bytes = GetModuleFileName(NULL, pBuf, len);
+    if (bytes) {
+        std::string str = std::string(pBuf);
+        str = str.substr(0, str.size() - 14);
+        str += "Resources\\";
+        return str;
+    }
+    else {
+        std::cout << "Buffer too small\n";
+        abort();
+    }
+}
+#elif __APPLE__
+
+#include <TargetConditionals.h>
+
+#if TARGET_OS_MAC
+
+#include <mach-o/dyld.h>
+
+std::string resource_path() {
+    char path[1024];
+    uint32_t size = sizeof(path);
+    if (_NSGetExecutablePath(path, &size) == 0) {
+        std::string str = std::string(path);
+        str = directory_from_file(str);
+        str += "Resources/";
+        return str;
+    } else {
+        std::cout << "Buffer too small\n";
+        abort();
+    }
+}
+
+#else
+#   error "Incompatible Apple platform"
+#endif
+#elif __linux__
+
+#include <libgen.h>         // dirname
+#include <unistd.h>         // readlink
+#include <linux/limits.h>   // PATH_MAX
+
+
+std::string resource_path() {
+    char pBuf[1024];
+    size_t len = sizeof(pBuf);
+
+
+    char result[PATH_MAX];
+    ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
+    const char *path;
+    if (count != -1) {
+        path = dirname(result);
+	return std::string(path) + "/Resources/";
+    }
+    else {
+        std::cout << "Buffer too small\n";
+        abort();
+    }
+}
+#else
+#   error "Unknown compiler"
+#endif
@@ -46,6 +46,9 @@ unsigned int txt_square_to_index(std::string str);
 
 std::vector<std::string> split(const std::string& line);
 
+// Mean and sample standard deviation, for timing runs; the deviation is 0 with fewer than two samples
+void mean_and_stddev(const std::vector<double>& xs, double& mean, double& stddev);
+
 namespace converter {
 
     old::piece_type piece_type_to_old(unsigned int piece);
@@ -12,96 +12,22 @@
 #include "Engine.hpp"
 #include "UCI.hpp"
 #include "Thread.hpp"
-#include "tests.hpp"
 
 
-std::string directory_from_file(std::string str) {
-    if (str.back() == '/') {
-        str.pop_back();
-    }
-    int index = str.size() - 1;
-    for (auto it = str.rbegin(); it != str.rend(); it++) {
-        if ((*it) == '/') {
-            break;
-        }
-        index--;
-    }
-    return str.substr(0, index + 1);
-}
-
-// Define resource_path();
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
-std::string resource_path() {
-    char pBuf[1024];
-    size_t len = sizeof(pBuf);
-    int bytes = GetModuleFileName(NULL, pBuf, len);
-    if (bytes) {
-        std::string str = std::string(pBuf);
-        str = str.substr(0, str.size() - 14);
-        str += "Resources\\";
-        return str;
-    }
-    else {
-        std::cout << "Buffer too small\n";
-        abort();
-    }
-}
-#elif __APPLE__
-
-#include <TargetConditionals.h>
-
-#if TARGET_OS_MAC
-
-#include <mach-o/dyld.h>
-
-std::string resource_path() {
-    char path[1024];
-    uint32_t size = sizeof(path);
-    if (_NSGetExecutablePath(path, &size) == 0) {
-        std::string str = std::string(path);
-        str = directory_from_file(str);
-        str += "Resources/";
-        return str;
-    } else {
-        std::cout << "Buffer too small\n";
-        abort();
-    }
-}
-
-#else
-#   error "Incompatible Apple platform"
-#endif
-#elif __linux__
-
-#include <libgen.h>         // dirname
-#include <unistd.h>         // readlink
-#include <linux/limits.h>   // PATH_MAX
+int main(int argc, char* argv[]) {
 
+    // Synchronization utils
+    Thread::SafeQueue<std::vector<std::string>> cmd_queue;
+    std::atomic<bool> should_end_search(false);
 
-std::string resource_path() {
-    char pBuf[1024];
-    size_t len = sizeof(pBuf);
-
+    // "Tuna bench [depth] [threads] [hash]", "Tuna scaling [depth] [max threads] [repetitions] [hash]" and
+    // "Tuna epd <file> [movetime ms] [concurrent positions] [hash]" run the suite and exit instead of speaking UCI
+    std::string mode = argc > 1 ? argv[1] : "";
+    bool bench_mode = mode == "bench" || mode == "scaling" || mode == "epd";
 
-    char result[PATH_MAX];
-    ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
-    const char *path;
-    if (count != -1) {
-        path = dirname(result);
-	return std::string(path) + "/Resources/";
-    }
-    else {
-        std::cout << "Buffer too small\n";
-        abort();
+    if (!bench_mode) {
+        init_uci(cmd_queue);
     }
-}
-#else
-#   error "Unknown compiler"
-#endif
-
-int main() {
-
-    init_uci();
 
     init_bitboard_utils();
     init_eval_utils();
@@ -109,16 +35,25 @@ int main() {
     init_zobrist_bitstrings();
     init_search();
 
+    if (bench_mode) {
+        // The bench sizes the TT itself, so don't allocate the default size first
+        TT tt(1);
+        OpeningBook opening_book;
+        std::vector<std::string> cmd(argv + 1, argv + argc);
+        if (mode == "bench") {
+            bench_command(cmd, tt, opening_book, should_end_search);
+        } else if (mode == "epd") {
+            epd_command(cmd);
+        } else {
+            scaling_command(cmd, tt, opening_book, should_end_search);
+        }
+        return 0;
+    }
+
 #if USE_BOOK
         init_opening_book();
 #endif
 
-//    tests();
-
-    // Synchronization utils
-    Thread::SafeQueue<std::vector<std::string>> cmd_queue;
-    std::atomic<bool> should_end_search(false);
-
     Engine engine(cmd_queue, should_end_search);
     UCI uci(cmd_queue, should_end_search);
 
@@ -0,0 +1,185 @@
+//
+// Times hot primitives in isolation over the bench positions, so nps changes can be pinned on a component
+//
+
+#include "depend.hpp"
+#include "Board.hpp"
+#include "Bitboard.hpp"
+#include "Evaluation.hpp"
+#include "Ray_gen.hpp"
+#include "Zobrist.hpp"
+#include "Search.hpp"
+#include "Transposition_table.hpp"
+#include "Bench.hpp"
+
+#include <functional>
+
+#define MICROBENCH_WARMUP_RUNS 2
+#define MICROBENCH_RUNS 10
+#define MICROBENCH_RUN_MS 50 // Passes over the positions are repeated until a run lasts at least this long
+
+// Results are folded in here so the compiler can't drop the work being timed
+volatile U64 sink;
+
+// A pass does the primitive over every position and returns how many times it did it
+typedef std::function<U64()> Pass;
+
+void time_primitive(const std::string& name, Pass pass) {
+    std::vector<double> ns_per_op;
+
+    for (int run = 0; run < MICROBENCH_WARMUP_RUNS + MICROBENCH_RUNS; run++) {
+        U64 ops = 0;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        auto t2 = t1;
+        do {
+            ops += pass();
+            t2 = std::chrono::high_resolution_clock::now();
+        } while (t2 - t1 < std::chrono::milliseconds(MICROBENCH_RUN_MS));
+
+        if (run >= MICROBENCH_WARMUP_RUNS) {
+            std::chrono::duration<double, std::nano> ns_double = t2 - t1;
+            ns_per_op.push_back(ns_double.count() / ops);
+        }
+    }
+
+    double mean, stddev;
+    mean_and_stddev(ns_per_op, mean, stddev);
+
+    std::ostringstream buffer;
+    buffer.setf(std::ios::fixed);
+    buffer.precision(2);
+    buffer.width(28);
+    buffer << std::left << name;
+    buffer.width(10);
+    buffer << std::right << mean;
+    buffer.width(10);
+    buffer << *std::min_element(ns_per_op.begin(), ns_per_op.end());
+    buffer.width(10);
+    buffer << stddev << '\n';
+    std::cout << buffer.str();
+}
+
+int main() {
+    init_bitboard_utils();
+    init_eval_utils();
+    init_ray_gen();
+    init_zobrist_bitstrings();
+    init_search();
+
+    std::vector<Board> boards;
+    std::vector<MoveList> legal_moves(bench_positions.size());
+    std::vector<MoveList> captures(bench_positions.size());
+    for (unsigned int i = 0; i < bench_positions.size(); i++) {
+        boards.emplace_back(bench_positions[i]);
+        boards[i].generate_moves(legal_moves[i]);
+        boards[i].generate_moves<CAPTURES_ONLY>(captures[i]);
+    }
+
+    // Keys of the positions one move in, looked up and stored the way the search would
+    std::vector<U64> keys;
+    for (unsigned int i = 0; i < boards.size(); i++) {
+        for (auto it = legal_moves[i].begin(); it != legal_moves[i].end(); ++it) {
+            boards[i].make_move(*it);
+            keys.push_back(boards[i].get_z_key());
+            boards[i].unmake_move();
+        }
+    }
+    TT tt;
+
+    std::cout << bench_positions.size() << " positions, " << MICROBENCH_RUNS << " runs of " << MICROBENCH_RUN_MS
+              << "ms after " << MICROBENCH_WARMUP_RUNS << " warmup runs\n\n";
+    std::cout << "primitive                        ns/op       min    stddev\n";
+
+    time_primitive("generate_moves<ALL_MOVES>", [&]() {
+        for (auto it = boards.begin(); it != boards.end(); ++it) {
+            MoveList moves;
+            it->generate_moves(moves);
+            sink += moves.size();
+        }
+        return (U64) boards.size();
+    });
+
+    time_primitive("generate_moves<CAPTURES>", [&]() {
+        for (auto it = boards.begin(); it != boards.end(); ++it) {
+            MoveList moves;
+            it->generate_moves<CAPTURES_ONLY>(moves);
+            sink += moves.size();
+        }
+        return (U64) boards.size();
+    });
+
+    time_primitive("make_move+unmake_move", [&]() {
+        U64 ops = 0;
+        for (unsigned int i = 0; i < boards.size(); i++) {
+            for (auto it = legal_moves[i].begin(); it != legal_moves[i].end(); ++it) {
+                boards[i].make_move(*it);
+                boards[i].unmake_move();
+            }
+            sink += boards[i].get_z_key();
+            ops += legal_moves[i].size();
+        }
+        return ops;
+    });
+
+    time_primitive("static_exchange_eval", [&]() {
+        U64 ops = 0;
+        for (unsigned int i = 0; i < boards.size(); i++) {
+            for (auto it = captures[i].begin(); it != captures[i].end(); ++it) {
+                sink += boards[i].static_exchange_eval(*it);
+            }
+            ops += captures[i].size();
+        }
+        return ops;
+    });
+
+    time_primitive("static_eval", [&]() {
+        for (auto it = boards.begin(); it != boards.end(); ++it) {
+            sink += it->static_eval();
+        }
+        return (U64) boards.size();
+    });
+
+    time_primitive("bishop_attacks", [&]() {
+        for (auto it = boards.begin(); it != boards.end(); ++it) {
+            U64 occ = it->get_occupancy();
+            for (int square = 0; square < 64; square++) {
+                sink ^= bishop_attacks(square, occ);
+            }
+        }
+        return (U64) boards.size() * 64;
+    });
+
+    time_primitive("rook_attacks", [&]() {
+        for (auto it = boards.begin(); it != boards.end(); ++it) {
+            U64 occ = it->get_occupancy();
+            for (int square = 0; square < 64; square++) {
+                sink ^= rook_attacks(square, occ);
+            }
+        }
+        return (U64) boards.size() * 64;
+    });
+
+    time_primitive("Board::hash", [&]() {
+        for (auto it = boards.begin(); it != boards.end(); ++it) {
+            it->hash();
+            sink += it->get_z_key();
+        }
+        return (U64) boards.size();
+    });
+
+    time_primitive("TT::set", [&]() {
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            tt.set(*it, Move(), 5, NODE_LOWERBOUND, (int) (*it & 0xFF));
+        }
+        return (U64) keys.size();
+    });
+
+    time_primitive("TT::get", [&]() {
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            sink += tt.get(*it).is_hit;
+        }
+        return (U64) keys.size();
+    });
+
+    return 0;
+}
@@ -4,69 +4,253 @@
 
 #include "tests.hpp"
 
-void test_perft(std::string fen, unsigned int depth, long target) {
+bool test_perft(std::string fen, unsigned int depth, U64 target) {
     Board board(fen);
-    OpeningBook ob;
-    TT tt;
-    std::atomic<bool> b;
-    TimeHandler th(b);
-
-
-    Search s(board, tt, ob, th);
-    long result = s.perft(depth);
+    U64 result = perft(board, depth);
 
     if (target != result) {
         std::cout << "Perft test failed: " << fen << " depth: " << depth << " Expected value: " << target << " Result: "
                   << result << '\n';
+        return false;
     }
+    return true;
 }
 
-void test_see(std::string s, std::string move, int value) {
+bool test_see(std::string s, std::string move, int value) {
     Board b(s);
     int result = b.static_exchange_eval(b.read_LAN(move));
     if (result != value) {
         std::cout << "SEE test failed: " << s << " move: " << move << " Expected value: " << value << " Result: "
                   << result << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool test_fen_round_trip(std::string fen) {
+    Board b(fen);
+    std::string result = b.get_FEN();
+    if (result != fen) {
+        std::cout << "FEN round trip failed: " << fen << " Result: " << result << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool test_epd_parse(std::string line, std::string fen, std::string best, std::string avoid, std::string id) {
+    EpdPosition position;
+    if (!parse_epd_line(line, position)) {
+        std::cout << "EPD parse failed: " << line << '\n';
+        return false;
+    }
+
+    std::string best_result, avoid_result;
+    for (auto it = position.best_moves.begin(); it != position.best_moves.end(); ++it) {
+        best_result += (best_result.empty() ? "" : " ") + move_to_str(*it, true);
+    }
+    for (auto it = position.avoid_moves.begin(); it != position.avoid_moves.end(); ++it) {
+        avoid_result += (avoid_result.empty() ? "" : " ") + move_to_str(*it, true);
+    }
+    if (position.fen != fen || best_result != best || avoid_result != avoid || position.id != id) {
+        std::cout << "EPD parse test failed: " << line << " Result: " << position.fen << " bm " << best_result
+                  << " am " << avoid_result << " id " << position.id << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool check_incremental_state(Board& board, const std::string& line) {
+    // Compares what make_move and unmake_move keep up to date against a recomputation from scratch
+    Board fresh = board;
+    fresh.hash();
+    fresh.calculate_piece_values();
+    fresh.calculate_piece_square_values();
+
+    bool ok = board.get_z_key() == fresh.get_z_key();
+    for (int side = 0; side < 2; side++) {
+        ok &= board.get_piece_values()[side] == fresh.get_piece_values()[side];
+        ok &= board.get_piece_square_values_m()[side] == fresh.get_piece_square_values_m()[side];
+        ok &= board.get_piece_square_values_e()[side] == fresh.get_piece_square_values_e()[side];
+    }
+    if (!ok) {
+        std::cout << "Incremental state differs from recomputation after" << line << " in " << board.get_FEN() << '\n';
+    }
+    return ok;
+}
+
+int make_unmake_walk(Board& board, unsigned int depth, const std::string& line) {
+    int failures = 0;
+    std::string fen = board.get_FEN();
+    U64 z_key = board.get_z_key();
+
+    MoveList moves;
+    board.generate_moves(moves);
+
+    for (auto it = moves.begin(); it != moves.end(); ++it) {
+        std::string move_line = line + ' ' + move_to_str(*it, true);
+
+        board.make_move(*it);
+        failures += !check_incremental_state(board, move_line);
+        if (depth > 1) {
+            failures += make_unmake_walk(board, depth - 1, move_line);
+        }
+        board.unmake_move();
+
+        if (board.get_FEN() != fen || board.get_z_key() != z_key) {
+            std::cout << "Unmaking" << move_line << " gave " << board.get_FEN() << " instead of " << fen << '\n';
+            failures++;
+        }
+        failures += !check_incremental_state(board, move_line + " unmade");
+
+        // One broken move usually breaks every line through it, so stop before flooding the output
+        if (failures) {
+            return failures;
+        }
+    }
+    return failures;
+}
+
+int perft_epd_tests(const std::string& path, U64 max_nodes) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "Could not open " << path << '\n';
+        return 1;
+    }
+
+    int failures = 0;
+    int checked = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        // fen ;D1 count ;D2 count ...
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ';')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 2) {
+            continue;
+        }
+        std::string fen = fields[0];
+        while (!fen.empty() && fen.back() == ' ') {
+            fen.pop_back();
+        }
+
+        for (unsigned int i = 1; i < fields.size(); i++) {
+            std::vector<std::string> depth_count = split(fields[i]);
+            unsigned int depth = std::stoi(depth_count.at(0).substr(1));
+            U64 count = std::stoull(depth_count.at(1));
+            if (count <= max_nodes) {
+                failures += !test_perft(fen, depth, count);
+                checked++;
+            }
+        }
     }
+    std::cout << checked << " perft counts checked\n";
+    return failures;
+}
+
+int see_tests() {
+    int failures = 0;
+    failures += !test_see("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", PAWN_VALUE);
+    failures += !test_see("4R3/2r3p1/5bk1/1p1r3p/p2PR1P1/P1BK1P2/1P6/8 b - - 0 1", "h5g4", 0);
+    failures += !test_see("4R3/2r3p1/5bk1/1p1r1p1p/p2PR1P1/P1BK1P2/1P6/8 b - - 0 1", "h5g4", 0);
+    failures += !test_see("4r1k1/5pp1/nbp4p/1p2p2q/1P2P1b1/1BP2N1P/1B2QPPK/3R4 b - - 0 1", "g4f3", KNIGHT_VALUE - BISHOP_VALUE);
+    failures += !test_see("2r1r1k1/pp1bppbp/3p1np1/q3P3/2P2P2/1P2B3/P1N1B1PP/2RQ1RK1 b - - 0 1", "d6e5", PAWN_VALUE);
+    failures += !test_see("7r/5qpk/p1Qp1b1p/3r3n/BB3p2/5p2/P1P2P2/4RK1R w - - 0 1", "e1e8", 0);
+    failures += !test_see("6rr/6pk/p1Qp1b1p/2n5/1B3p2/5p2/P1P2P2/4RK1R w - - 0 1", "e1e8", -ROOK_VALUE);
+    failures += !test_see("7r/5qpk/2Qp1b1p/1N1r3n/BB3p2/5p2/P1P2P2/4RK1R w - - 0 1", "e1e8", -ROOK_VALUE);
+//    failures += !test_see("6RR/4bP2/8/8/5r2/3K4/5p2/4k3 w - - 0 1", "f7f8q", BISHOP_VALUE-PAWN_VALUE);
+//    failures += !test_see("6RR/4bP2/8/8/5r2/3K4/5p2/4k3 w - - 0 1", "f7f8n", KNIGHT_VALUE-PAWN_VALUE);
+//    failures += !test_see("7R/4bP2/8/8/1q6/3K4/5p2/4k3 w - - 0 1", "f7f8r", -PAWN_VALUE);
+    failures += !test_see("8/4kp2/2npp3/1Nn5/1p2PQP1/7q/1PP1B3/4KR1r b - - 0 1", "h1f1", 0);
+    failures += !test_see("8/4kp2/2npp3/1Nn5/1p2P1P1/7q/1PP1B3/4KR1r b - - 0 1", "h1f1", 0);
+    failures += !test_see("2r2r1k/6bp/p7/2q2p1Q/3PpP2/1B6/P5PP/2RR3K b - - 0 1", "c5c1", 2 * ROOK_VALUE - QUEEN_VALUE);
+    failures += !test_see("r2qk1nr/pp2ppbp/2b3p1/2p1p3/8/2N2N2/PPPP1PPP/R1BQR1K1 w kq - 0 1", "f3e5", PAWN_VALUE);
+    failures += !test_see("6r1/4kq2/b2p1p2/p1pPb3/p1P2B1Q/2P4P/2B1R1P1/6K1 w - - 0 1", "f4e5", 0);
+    failures += !test_see("3q2nk/pb1r1p2/np6/3P2Pp/2p1P3/2R4B/PQ3P1P/3R2K1 w - h6 0 1", "g5h6", 0);
+    failures += !test_see("3q2nk/pb1r1p2/np6/3P2Pp/2p1P3/2R1B2B/PQ3P1P/3R2K1 w - h6 0 1", "g5h6", PAWN_VALUE);
+    failures += !test_see("2r4r/1P4pk/p2p1b1p/7n/BB3p2/2R2p2/P1P2P2/4RK2 w - - 0 1", "c3c8", ROOK_VALUE);
+//    failures += !test_see("2r5/1P4pk/p2p1b1p/5b1n/BB3p2/2R2p2/P1P2P2/4RK2 w - - 0 1", "c3c8", ROOK_VALUE);
+    failures += !test_see("2r4k/2r4p/p7/2b2p1b/4pP2/1BR5/P1R3PP/2Q4K w - - 0 1", "c3c5", BISHOP_VALUE);
+    failures += !test_see("8/pp6/2pkp3/4bp2/2R3b1/2P5/PP4B1/1K6 w - - 0 1", "g2c6", PAWN_VALUE - BISHOP_VALUE);
+    failures += !test_see("4q3/1p1pr1k1/1B2rp2/6p1/p3PP2/P3R1P1/1P2R1K1/4Q3 b - - 0 1", "e6e4", PAWN_VALUE - ROOK_VALUE);
+    failures += !test_see("4q3/1p1pr1kb/1B2rp2/6p1/p3PP2/P3R1P1/1P2R1K1/4Q3 b - - 0 1", "h7e4", PAWN_VALUE);
+    return failures;
 }
 
-// Perft tests take a while
-void perft_summary_tests() {
-    test_perft("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324);
-    test_perft("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690);
-    test_perft("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 7, 178633661);
-    test_perft("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292);
-    test_perft("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194);
-    test_perft("8/8/b2p3p/7k/7P/K5P1/4p3/3B4 b - - 1 71", 7, 31728295);
+int fen_tests() {
+    int failures = 0;
+    for (auto it = bench_positions.begin(); it != bench_positions.end(); ++it) {
+        failures += !test_fen_round_trip(*it);
+    }
+    failures += !test_fen_round_trip("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    failures += !test_fen_round_trip("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2");
+    failures += !test_fen_round_trip("r3k2r/8/8/8/8/8/8/R3K2R w Kq - 12 40");
+    return failures;
 }
 
-void tests() {
-    test_see("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100);
-    test_see("4R3/2r3p1/5bk1/1p1r3p/p2PR1P1/P1BK1P2/1P6/8 b - - 0 1", "h5g4", 0);
-    test_see("4R3/2r3p1/5bk1/1p1r1p1p/p2PR1P1/P1BK1P2/1P6/8 b - - 0 1", "h5g4", 0);
-    test_see("4r1k1/5pp1/nbp4p/1p2p2q/1P2P1b1/1BP2N1P/1B2QPPK/3R4 b - - 0 1", "g4f3", 0);
-    test_see("2r1r1k1/pp1bppbp/3p1np1/q3P3/2P2P2/1P2B3/P1N1B1PP/2RQ1RK1 b - - 0 1", "d6e5", PAWN_VALUE);
-    test_see("7r/5qpk/p1Qp1b1p/3r3n/BB3p2/5p2/P1P2P2/4RK1R w - - 0 1", "e1e8", 0);
-    test_see("6rr/6pk/p1Qp1b1p/2n5/1B3p2/5p2/P1P2P2/4RK1R w - - 0 1", "e1e8", -ROOK_VALUE);
-    test_see("7r/5qpk/2Qp1b1p/1N1r3n/BB3p2/5p2/P1P2P2/4RK1R w - - 0 1", "e1e8", -ROOK_VALUE);
-//    test_see("6RR/4bP2/8/8/5r2/3K4/5p2/4k3 w - - 0 1", "f7f8q", BISHOP_VALUE-PAWN_VALUE);
-//    test_see("6RR/4bP2/8/8/5r2/3K4/5p2/4k3 w - - 0 1", "f7f8n", KNIGHT_VALUE-PAWN_VALUE);
-//    test_see("7R/4bP2/8/8/1q6/3K4/5p2/4k3 w - - 0 1", "f7f8r", -PAWN_VALUE);
-    test_see("8/4kp2/2npp3/1Nn5/1p2PQP1/7q/1PP1B3/4KR1r b - - 0 1", "h1f1", 0);
-    test_see("8/4kp2/2npp3/1Nn5/1p2P1P1/7q/1PP1B3/4KR1r b - - 0 1", "h1f1", 0);
-    test_see("2r2r1k/6bp/p7/2q2p1Q/3PpP2/1B6/P5PP/2RR3K b - - 0 1", "c5c1", 2 * ROOK_VALUE - QUEEN_VALUE);
-    test_see("r2qk1nr/pp2ppbp/2b3p1/2p1p3/8/2N2N2/PPPP1PPP/R1BQR1K1 w kq - 0 1", "f3e5", PAWN_VALUE);
-    test_see("6r1/4kq2/b2p1p2/p1pPb3/p1P2B1Q/2P4P/2B1R1P1/6K1 w - - 0 1", "f4e5", 0);
-    test_see("3q2nk/pb1r1p2/np6/3P2Pp/2p1P3/2R4B/PQ3P1P/3R2K1 w - h6 0 1", "g5h6", 0);
-    test_see("3q2nk/pb1r1p2/np6/3P2Pp/2p1P3/2R1B2B/PQ3P1P/3R2K1 w - h6 0 1", "g5h6", PAWN_VALUE);
-    test_see("2r4r/1P4pk/p2p1b1p/7n/BB3p2/2R2p2/P1P2P2/4RK2 w - - 0 1", "c3c8", ROOK_VALUE);
-//    test_see("2r5/1P4pk/p2p1b1p/5b1n/BB3p2/2R2p2/P1P2P2/4RK2 w - - 0 1", "c3c8", ROOK_VALUE);
-    test_see("2r4k/2r4p/p7/2b2p1b/4pP2/1BR5/P1R3PP/2Q4K w - - 0 1", "c3c5", BISHOP_VALUE);
-    test_see("8/pp6/2pkp3/4bp2/2R3b1/2P5/PP4B1/1K6 w - - 0 1", "g2c6", PAWN_VALUE - BISHOP_VALUE);
-    test_see("4q3/1p1pr1k1/1B2rp2/6p1/p3PP2/P3R1P1/1P2R1K1/4Q3 b - - 0 1", "e6e4", PAWN_VALUE - ROOK_VALUE);
-    test_see("4q3/1p1pr1kb/1B2rp2/6p1/p3PP2/P3R1P1/1P2R1K1/4Q3 b - - 0 1", "h7e4", PAWN_VALUE);
-
-    perft_summary_tests();
-
-    std::cout << std::endl;
+int epd_tests() {
+    int failures = 0;
+    failures += !test_epd_parse("2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - bm Qg6; id \"WAC.001\";",
+                                "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1", "g3g6", "", "WAC.001");
+    failures += !test_epd_parse("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3 am Nxe5;",
+                                "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3", "", "f3e5", "");
+    failures += !test_epd_parse("8/1P6/8/8/8/8/k7/4K3 w - - bm b8=Q b8=R!; id \"two solutions\";",
+                                "8/1P6/8/8/8/8/k7/4K3 w - - 0 1", "b7b8q b7b8r", "", "two solutions");
+    failures += !test_epd_parse("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - bm O-O-O; am Kd7;",
+                                "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1", "e8c8", "e8d7", "");
+
+    // Positions without a bm or am can't be scored
+    EpdPosition position;
+    if (parse_epd_line("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - id \"start\";", position)) {
+        std::cout << "EPD parse test failed: accepted a line without bm or am\n";
+        failures++;
+    }
+    return failures;
+}
+
+int make_unmake_tests(unsigned int depth) {
+    int failures = 0;
+    for (auto it = bench_positions.begin(); it != bench_positions.end(); ++it) {
+        Board board(*it);
+        failures += !check_incremental_state(board, " setup");
+        failures += make_unmake_walk(board, depth, "");
+    }
+    return failures;
+}
+
+// tuna_tests <perft <epd> [max nodes] | see | fen | epd | makeunmake [depth]>, registered with ctest
+int main(int argc, char* argv[]) {
+    init_bitboard_utils();
+    init_eval_utils();
+    init_ray_gen();
+    init_zobrist_bitstrings();
+    init_search();
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.empty()) {
+        std::cout << "Usage: tuna_tests <perft <epd> [max nodes] | see | fen | epd | makeunmake [depth]>\n";
+        return 1;
+    }
+
+    int failures = 0;
+    if (args[0] == "perft" && args.size() > 1) {
+        U64 max_nodes = args.size() > 2 ? std::stoull(args[2]) : PERFT_TEST_MAX_NODES;
+        failures = perft_epd_tests(args[1], max_nodes);
+    } else if (args[0] == "see") {
+        failures = see_tests();
+    } else if (args[0] == "fen") {
+        failures = fen_tests();
+    } else if (args[0] == "epd") {
+        failures = epd_tests();
+    } else if (args[0] == "makeunmake") {
+        failures = make_unmake_tests(args.size() > 1 ? std::stoi(args[1]) : MAKE_UNMAKE_TEST_DEPTH);
+    } else {
+        std::cout << "Unknown test suite: " << args[0] << '\n';
+        return 1;
+    }
+
+    std::cout << args[0] << ": " << failures << " failures\n";
+    return failures ? 1 : 0;
 }
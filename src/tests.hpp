@@ -6,13 +6,44 @@
 #define BITBOARD_CHESS_TESTS_HPP
 
 #include "Board.hpp"
+#include "Bitboard.hpp"
+#include "Evaluation.hpp"
+#include "Ray_gen.hpp"
+#include "Zobrist.hpp"
 #include "Search.hpp"
-#include "Transposition_table.hpp"
-#include "Opening_book.hpp"
-#include "Time_handler.hpp"
+#include "Perft.hpp"
+#include "Bench.hpp"
+#include "Epd.hpp"
 
-void test_perft(std::string fen, unsigned int depth, long result);
+#include <sstream>
 
-void tests();
+#define PERFT_TEST_MAX_NODES 5000000 // Deeper counts in the EPD are only checked when asked for
+#define MAKE_UNMAKE_TEST_DEPTH 2
+
+// Each test prints what went wrong and returns false on failure
+bool test_perft(std::string fen, unsigned int depth, U64 target);
+
+bool test_see(std::string s, std::string move, int value);
+
+bool test_fen_round_trip(std::string fen);
+
+// best and avoid are the expected bm and am moves in long algebraic notation, separated by spaces
+bool test_epd_parse(std::string line, std::string fen, std::string best, std::string avoid, std::string id);
+
+bool check_incremental_state(Board& board, const std::string& line);
+
+// Makes and unmakes every line depth plies deep, checking the board after each make and unmake
+int make_unmake_walk(Board& board, unsigned int depth, const std::string& line);
+
+// The suites return their number of failures
+int perft_epd_tests(const std::string& path, U64 max_nodes);
+
+int see_tests();
+
+int fen_tests();
+
+int epd_tests();
+
+int make_unmake_tests(unsigned int depth);
 
 #endif //BITBOARD_CHESS_TESTS_HPP